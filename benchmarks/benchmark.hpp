@@ -0,0 +1,267 @@
+/**
+ * KFR (http://kfrlib.com)
+ * Copyright (C) 2016  D Levin
+ * See LICENSE.txt for details
+ */
+#pragma once
+
+#include <kfr/cometa/string.hpp>
+#include <kfr/io/python_plot.hpp>
+#include <kfr/io/tostring.hpp>
+#include <kfr/version.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+using namespace kfr;
+
+/// Reads the processor cycle counter (rdtsc on x86), or 0 where the compiler has no such builtin
+inline u64 read_cycle_counter()
+{
+#if __has_builtin(__builtin_readcyclecounter)
+    return __builtin_readcyclecounter();
+#else
+    return 0;
+#endif
+}
+
+/// Makes the optimizer assume the memory behind ptr has been read and written
+inline void clobber(const void* ptr) { __asm__ __volatile__("" : : "r"(ptr) : "memory"); }
+
+struct result
+{
+    std::string group;
+    std::string name;
+    double x;
+    double ns_per_sample;
+    double gflops;
+    double cycles_per_sample;
+};
+
+/// Collects measurements and writes them as a table, CSV (--csv), JSON (--json) or plots (--plot).
+/// Results in one group share the x axis and are drawn as one perfplot, one line per name
+class suite
+{
+public:
+    suite(const std::string& name, int argc, char** argv)
+        : name(name), min_time(0.05), repeats(5), csv(false), json(false), plot(false)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* arg = argv[i];
+            if (!strcmp(arg, "--csv"))
+                csv = true;
+            else if (!strcmp(arg, "--json"))
+                json = true;
+            else if (!strcmp(arg, "--plot"))
+                plot = true;
+            else if (!strncmp(arg, "--time=", 7))
+                min_time = std::max(0.001, atof(arg + 7));
+            else if (!strncmp(arg, "--filter=", 9))
+                filter = arg + 9;
+            else
+                println("unknown option: ", arg);
+        }
+        println(name, ": ", library_version());
+        println(pad("group", 24), pad("name", 24), pad("x", 10), pad("ns/sample", 14), pad("GFLOPS", 10),
+                pad("cycles/sample", 16));
+    }
+
+    /// Starts a new group, xlabel names the quantity passed as x to run()
+    void group(const std::string& group_name, const std::string& xlabel)
+    {
+        current_group = group_name;
+        groups.push_back(group_info{ group_name, xlabel });
+    }
+
+    /// Measures fn(). Each call processes samples samples and performs flops floating-point operations
+    template <typename Fn>
+    void run(const std::string& run_name, double x, size_t samples, double flops, Fn&& fn)
+    {
+        if (!filter.empty() && current_group.find(filter) == std::string::npos)
+            return;
+        using clock = std::chrono::high_resolution_clock;
+
+        fn();
+
+        // find the iteration count that takes min_time / repeats
+        size_t iterations = 1;
+        for (;;)
+        {
+            const auto start = clock::now();
+            for (size_t i = 0; i < iterations; i++)
+                fn();
+            const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            if (elapsed >= min_time / repeats || iterations >= (size_t(1) << 30))
+                break;
+            iterations *= elapsed > 0 ? std::min(size_t(64), size_t(min_time / repeats / elapsed) + 2) : 64;
+        }
+
+        double best_ns     = std::numeric_limits<double>::max();
+        double best_cycles = std::numeric_limits<double>::max();
+        for (size_t r = 0; r < repeats; r++)
+        {
+            const u64 start_cycles = read_cycle_counter();
+            const auto start       = clock::now();
+            for (size_t i = 0; i < iterations; i++)
+                fn();
+            const auto stop       = clock::now();
+            const u64 stop_cycles = read_cycle_counter();
+            best_ns     = std::min(best_ns, std::chrono::duration<double, std::nano>(stop - start).count());
+            best_cycles = std::min(best_cycles, double(stop_cycles - start_cycles));
+        }
+        best_ns /= iterations;
+        best_cycles /= iterations;
+
+        const result res{ current_group,        run_name,    x, best_ns / samples, flops / best_ns,
+                          best_cycles / samples };
+        results.push_back(res);
+        println(pad(res.group, 24), pad(res.name, 24), fmt<'g', 10, 6>(res.x), fmt<'f', 14, 4>(res.ns_per_sample),
+                fmt<'f', 10, 3>(res.gflops), fmt<'f', 16, 3>(res.cycles_per_sample));
+    }
+
+    /// Writes the requested outputs, returns the process exit code
+    int finish() const
+    {
+        if (csv)
+            write_file(name + ".csv", to_csv());
+        if (json)
+            write_file(name + ".json", to_json());
+        if (plot)
+        {
+            for (const group_info& g : groups)
+            {
+                std::vector<std::string> labels;
+                const std::vector<std::vector<double>> table = pivot(g.name, labels);
+                if (!table.empty())
+                    perfplot_save(g.name, table, labels,
+                                  "title='" + g.name + "', xlabel='" + g.xlabel + "', units='ns/sample'");
+            }
+        }
+        return 0;
+    }
+
+private:
+    struct group_info
+    {
+        std::string name;
+        std::string xlabel;
+    };
+
+    // rows of [x, ns/sample of each name], the layout perfplot_save takes
+    std::vector<std::vector<double>> pivot(const std::string& group_name, std::vector<std::string>& labels) const
+    {
+        std::vector<double> xs;
+        for (const result& r : results)
+        {
+            if (r.group != group_name)
+                continue;
+            if (std::find(labels.begin(), labels.end(), r.name) == labels.end())
+                labels.push_back(r.name);
+            if (std::find(xs.begin(), xs.end(), r.x) == xs.end())
+                xs.push_back(r.x);
+        }
+        std::vector<std::vector<double>> table(xs.size(), std::vector<double>(labels.size() + 1, 0.0));
+        for (size_t i = 0; i < xs.size(); i++)
+            table[i][0] = xs[i];
+        for (const result& r : results)
+        {
+            if (r.group != group_name)
+                continue;
+            const size_t row = std::find(xs.begin(), xs.end(), r.x) - xs.begin();
+            const size_t col = std::find(labels.begin(), labels.end(), r.name) - labels.begin();
+            table[row][col + 1] = r.ns_per_sample;
+        }
+        return table;
+    }
+
+    static std::string pad(const std::string& str, size_t width)
+    {
+        return str.size() >= width ? " " + str : std::string(width - str.size(), ' ') + str;
+    }
+
+    static std::string number(double x) { return as_string(fmt<'g', -1, 17>(x)); }
+
+    std::string to_csv() const
+    {
+        std::string s = "group,name,x,ns_per_sample,gflops,cycles_per_sample\n";
+        for (const result& r : results)
+            s += r.group + "," + r.name + "," + number(r.x) + "," + number(r.ns_per_sample) + "," +
+                 number(r.gflops) + "," + number(r.cycles_per_sample) + "\n";
+        return s;
+    }
+
+    // {"<group>": {"xlabel", "labels", "data", "results"}}; "labels" and "data" are the arguments of
+    // dspplot.perfplot
+    std::string to_json() const
+    {
+        std::string s = "{\n";
+        for (size_t g = 0; g < groups.size(); g++)
+        {
+            std::vector<std::string> labels;
+            const std::vector<std::vector<double>> table = pivot(groups[g].name, labels);
+            s += "  \"" + groups[g].name + "\": {\n";
+            s += "    \"xlabel\": \"" + groups[g].xlabel + "\",\n";
+            s += "    \"labels\": [";
+            for (size_t i = 0; i < labels.size(); i++)
+                s += (i ? ", \"" : "\"") + labels[i] + "\"";
+            s += "],\n    \"data\": [";
+            for (size_t i = 0; i < table.size(); i++)
+            {
+                s += i ? ", [" : "[";
+                for (size_t j = 0; j < table[i].size(); j++)
+                    s += (j ? ", " : "") + number(table[i][j]);
+                s += "]";
+            }
+            s += "],\n    \"results\": [";
+            bool first = true;
+            for (const result& r : results)
+            {
+                if (r.group != groups[g].name)
+                    continue;
+                s += first ? "\n" : ",\n";
+                s += "      {\"name\": \"" + r.name + "\", \"x\": " + number(r.x) +
+                     ", \"ns_per_sample\": " + number(r.ns_per_sample) + ", \"gflops\": " + number(r.gflops) +
+                     ", \"cycles_per_sample\": " + number(r.cycles_per_sample) + "}";
+                first = false;
+            }
+            s += "]\n  }";
+            s += g + 1 < groups.size() ? ",\n" : "\n";
+        }
+        s += "}\n";
+        return s;
+    }
+
+    static void write_file(const std::string& filename, const std::string& contents)
+    {
+        FILE* f = fopen(filename.c_str(), "w");
+        if (!f)
+        {
+            println("can't write ", filename);
+            return;
+        }
+        fwrite(contents.data(), 1, contents.size(), f);
+        fclose(f);
+        println("written ", filename);
+    }
+
+    std::string name;
+    std::string filter;
+    std::string current_group;
+    double min_time;
+    size_t repeats;
+    bool csv;
+    bool json;
+    bool plot;
+    std::vector<group_info> groups;
+    std::vector<result> results;
+};
+}
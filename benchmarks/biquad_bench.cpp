@@ -0,0 +1,49 @@
+/**
+ * KFR (http://kfrlib.com)
+ * Copyright (C) 2016  D Levin
+ * See LICENSE.txt for details
+ */
+
+#include "benchmark.hpp"
+
+#include <kfr/dsp/biquad.hpp>
+#include <kfr/expressions/basic.hpp>
+#include <kfr/math.hpp>
+#include <kfr/misc/random.hpp>
+
+using namespace kfr;
+using namespace kfr::native;
+
+constexpr size_t block_size = 4096;
+
+template <typename T, size_t filters>
+static void bench_biquad(benchmark::suite& suite, const std::string& name, csize_t<filters>)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<T> in = typed<T>(gen_random_range(gen, -1.0, +1.0), block_size);
+    univector<T> out(block_size);
+
+    biquad_params<T> bq[filters];
+    for (size_t i = 0; i < filters; i++)
+        bq[i] = biquad_peak(T(0.02 + 0.4 * i / filters), T(0.5), T(3.0));
+
+    // 5 multiplications and 4 additions per section (transposed direct form II)
+    auto cascade = biquad(bq, in);
+    suite.run(name, double(filters), block_size, 9.0 * filters * block_size, [&]() {
+        out = cascade;
+        benchmark::clobber(out.data());
+    });
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::suite suite("biquad_bench", argc, argv);
+
+    suite.group("biquad", "sections");
+    cforeach(csizes<1, 2, 4, 8, 16, 32>, [&](auto filters) {
+        bench_biquad<float>(suite, "f32", filters);
+        bench_biquad<double>(suite, "f64", filters);
+    });
+
+    return suite.finish();
+}
@@ -0,0 +1,72 @@
+/**
+ * KFR (http://kfrlib.com)
+ * Copyright (C) 2016  D Levin
+ * See LICENSE.txt for details
+ */
+
+#include "benchmark.hpp"
+
+#include <kfr/dft/fft.hpp>
+#include <kfr/expressions/basic.hpp>
+#include <kfr/misc/random.hpp>
+
+using namespace kfr;
+
+template <typename T>
+static void bench_dft(benchmark::suite& suite, const std::string& name, size_t size, bool inverse,
+                      bool unordered)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<complex<T>> in = typed<T>(gen_random_range(gen, -1.0, +1.0), size * 2);
+    univector<complex<T>> out(size);
+    dft_plan<T> dft(size);
+    if (unordered)
+        dft.enable_unordered();
+    univector<u8> temp(dft.temp_size);
+
+    // 5 N log2(N) is the conventional flop count of a complex transform of any size
+    const double flops = 5.0 * size * std::log2(double(size));
+    suite.run(name, double(size), size, flops, [&]() {
+        if (unordered)
+            dft.execute_unordered(out.data(), in.data(), temp.data(), inverse);
+        else
+            dft.execute(out, in, temp, inverse);
+        benchmark::clobber(out.data());
+    });
+}
+
+template <typename T>
+static void bench_dft_group(benchmark::suite& suite, const char* prefix, size_t size, bool unordered = false)
+{
+    bench_dft<T>(suite, as_string(prefix, "-forward"), size, false, unordered);
+    bench_dft<T>(suite, as_string(prefix, "-inverse"), size, true, unordered);
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::suite suite("dft_bench", argc, argv);
+
+    suite.group("dft_pow2", "size");
+    for (size_t log2size = 4; log2size <= 20; log2size++)
+    {
+        bench_dft_group<float>(suite, "f32", size_t(1) << log2size);
+        bench_dft_group<double>(suite, "f64", size_t(1) << log2size);
+    }
+
+    // the same sizes without the reordering pass, as used by fast convolution
+    suite.group("dft_unordered", "size");
+    for (size_t log2size = 9; log2size <= 20; log2size++)
+    {
+        bench_dft_group<float>(suite, "f32", size_t(1) << log2size, true);
+        bench_dft_group<double>(suite, "f64", size_t(1) << log2size, true);
+    }
+
+    suite.group("dft_other", "size");
+    for (size_t size : { 15, 30, 48, 60, 96, 100, 120, 210, 480, 960, 1000, 3000, 6000, 10000, 44100 })
+    {
+        bench_dft_group<float>(suite, "f32", size);
+        bench_dft_group<double>(suite, "f64", size);
+    }
+
+    return suite.finish();
+}
@@ -0,0 +1,168 @@
+/**
+ * KFR (http://kfrlib.com)
+ * Copyright (C) 2016  D Levin
+ * See LICENSE.txt for details
+ */
+
+#include "benchmark.hpp"
+
+#include <kfr/dft/conv.hpp>
+#include <kfr/dsp/fir.hpp>
+#include <kfr/dsp/window.hpp>
+#include <kfr/expressions/basic.hpp>
+#include <kfr/expressions/pointer.hpp>
+#include <kfr/math.hpp>
+#include <kfr/misc/random.hpp>
+
+using namespace kfr;
+using namespace kfr::native;
+
+constexpr size_t block_size = 4096;
+
+template <typename T, size_t Tag>
+static void make_taps(univector<T, Tag>& taps)
+{
+    const expression_pointer<T> kaiser = to_pointer(window_kaiser(taps.size(), T(3.0)));
+    fir_lowpass(taps, T(0.2), kaiser, true);
+}
+
+template <typename T>
+static void bench_fir(benchmark::suite& suite, const std::string& name, size_t tapcount)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<T> in = typed<T>(gen_random_range(gen, -1.0, +1.0), block_size);
+    univector<T> out(block_size);
+    univector<T> taps(tapcount);
+    make_taps(taps);
+
+    // the filter keeps its delay line between blocks as in streaming use
+    auto filter = fir(in, taps);
+    suite.run(name, double(tapcount), block_size, 2.0 * tapcount * block_size, [&]() {
+        out = filter;
+        benchmark::clobber(out.data());
+    });
+}
+
+template <typename T, typename Filter = fir_filter<T>>
+static void bench_fir_filter(benchmark::suite& suite, const std::string& name, size_t tapcount)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<T> in = typed<T>(gen_random_range(gen, -1.0, +1.0), block_size);
+    univector<T> out(block_size);
+    univector<T> taps(tapcount);
+    make_taps(taps);
+
+    Filter filter(taps);
+    suite.run(name, double(tapcount), block_size, 2.0 * tapcount * block_size, [&]() {
+        filter.process(out, in);
+        benchmark::clobber(out.data());
+    });
+}
+
+template <typename T>
+static void bench_fir_bank(benchmark::suite& suite, const std::string& name, size_t channels)
+{
+    constexpr size_t tapcount = 32;
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<T> in = typed<T>(gen_random_range(gen, -1.0, +1.0), block_size * channels);
+    univector<T> out(block_size * channels);
+    univector<T> taps(tapcount);
+    make_taps(taps);
+
+    // ns/sample is per frame of all channels
+    fir_bank<T> bank(channels, taps);
+    suite.run(name, double(channels), block_size, 2.0 * tapcount * block_size * channels, [&]() {
+        bank.process_interleaved(out, in);
+        benchmark::clobber(out.data());
+    });
+}
+
+template <typename T>
+static void bench_fir_polyphase(benchmark::suite& suite, const std::string& name, size_t factor)
+{
+    constexpr size_t tapcount = 128;
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<T> in = typed<T>(gen_random_range(gen, -1.0, +1.0), block_size);
+    univector<T> out(block_size * factor);
+    univector<T> taps(tapcount);
+    make_taps(taps);
+
+    // ns/sample is per input sample, one multiply-add per tap and output
+    fir_decimator<T> decimator(factor, taps);
+    suite.run(name + "_decimator", double(factor), block_size, 2.0 * tapcount * block_size / factor, [&]() {
+        decimator.process(out, in);
+        benchmark::clobber(out.data());
+    });
+    fir_interpolator<T> interpolator(factor, taps);
+    suite.run(name + "_interpolator", double(factor), block_size, 2.0 * tapcount * block_size, [&]() {
+        interpolator.process(out, in);
+        benchmark::clobber(out.data());
+    });
+}
+
+template <typename T, size_t tapcount>
+static void bench_short_fir(benchmark::suite& suite, const std::string& name, csize_t<tapcount>)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<T> in = typed<T>(gen_random_range(gen, -1.0, +1.0), block_size);
+    univector<T> out(block_size);
+    univector<T, tapcount> taps;
+    make_taps(taps);
+
+    auto filter = short_fir(in, taps);
+    suite.run(name, double(tapcount), block_size, 2.0 * tapcount * block_size, [&]() {
+        out = filter;
+        benchmark::clobber(out.data());
+    });
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::suite suite("fir_bench", argc, argv);
+
+    suite.group("fir", "taps");
+    for (size_t tapcount : { 8, 16, 32, 64, 127, 256, 511, 1024 })
+    {
+        bench_fir<float>(suite, "f32", tapcount);
+        bench_fir<double>(suite, "f64", tapcount);
+    }
+
+    suite.group("fir_filter", "taps");
+    for (size_t tapcount : { 8, 16, 32, 64, 127, 256, 511, 1024 })
+    {
+        bench_fir_filter<float>(suite, "f32", tapcount);
+        bench_fir_filter<double>(suite, "f64", tapcount);
+    }
+
+    // both engines over the range of the crossover, flops are counted as for the direct form
+    suite.group("fft_fir_filter", "taps");
+    for (size_t tapcount : { 256, 1024, 4096, 16384 })
+    {
+        bench_fir_filter<float>(suite, "direct_f32", tapcount);
+        bench_fir_filter<float, fft_fir_filter<float>>(suite, "fft_f32", tapcount);
+        bench_fir_filter<double>(suite, "direct_f64", tapcount);
+        bench_fir_filter<double, fft_fir_filter<double>>(suite, "fft_f64", tapcount);
+    }
+
+    suite.group("fir_bank", "channels");
+    for (size_t channels : { 8, 16, 32, 64 })
+    {
+        bench_fir_bank<float>(suite, "f32", channels);
+        bench_fir_bank<double>(suite, "f64", channels);
+    }
+
+    suite.group("fir_polyphase", "factor");
+    for (size_t factor : { 2, 4, 8 })
+    {
+        bench_fir_polyphase<float>(suite, "f32", factor);
+        bench_fir_polyphase<double>(suite, "f64", factor);
+    }
+
+    suite.group("short_fir", "taps");
+    cforeach(csizes<2, 3, 4, 7, 8, 11, 15>, [&](auto tapcount) {
+        bench_short_fir<float>(suite, "f32", tapcount);
+        bench_short_fir<double>(suite, "f64", tapcount);
+    });
+
+    return suite.finish();
+}
@@ -0,0 +1,65 @@
+/**
+ * KFR (http://kfrlib.com)
+ * Copyright (C) 2016  D Levin
+ * See LICENSE.txt for details
+ */
+
+#include "benchmark.hpp"
+
+#include <kfr/expressions/basic.hpp>
+#include <kfr/math.hpp>
+#include <kfr/misc/random.hpp>
+
+using namespace kfr;
+using namespace kfr::native;
+
+template <typename T, typename Fn>
+static void bench_function(benchmark::suite& suite, const std::string& name, size_t size, Fn&& fn)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    // (0.01, 0.99) is inside the domain of every function measured here
+    univector<T> in = typed<T>(gen_random_range(gen, 0.01, 0.99), size);
+    univector<T> out(size);
+
+    // one function evaluation is counted as one operation
+    suite.run(name, double(size), size, double(size), [&]() {
+        out = fn(in);
+        benchmark::clobber(out.data());
+    });
+}
+
+template <typename T>
+static void bench_math(benchmark::suite& suite, const char* type_name)
+{
+    const size_t sizes[] = { 256, 4096, 65536, 1048576 };
+
+    suite.group(as_string("math_", type_name), "size");
+    for (size_t size : sizes)
+    {
+        bench_function<T>(suite, "sin", size, [](const univector<T>& x) { return sin(x); });
+        bench_function<T>(suite, "cos", size, [](const univector<T>& x) { return cos(x); });
+        bench_function<T>(suite, "exp", size, [](const univector<T>& x) { return exp(x); });
+        bench_function<T>(suite, "log", size, [](const univector<T>& x) { return log(x); });
+        bench_function<T>(suite, "sqrt", size, [](const univector<T>& x) { return sqrt(x); });
+    }
+
+    suite.group(as_string("math_ext_", type_name), "size");
+    for (size_t size : sizes)
+    {
+        bench_function<T>(suite, "tan", size, [](const univector<T>& x) { return tan(x); });
+        bench_function<T>(suite, "atan", size, [](const univector<T>& x) { return atan(x); });
+        bench_function<T>(suite, "asin", size, [](const univector<T>& x) { return asin(x); });
+        bench_function<T>(suite, "sinh", size, [](const univector<T>& x) { return sinh(x); });
+        bench_function<T>(suite, "log10", size, [](const univector<T>& x) { return log10(x); });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::suite suite("math_bench", argc, argv);
+
+    bench_math<float>(suite, "f32");
+    bench_math<double>(suite, "f64");
+
+    return suite.finish();
+}
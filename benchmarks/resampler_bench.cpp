@@ -0,0 +1,64 @@
+/**
+ * KFR (http://kfrlib.com)
+ * Copyright (C) 2016  D Levin
+ * See LICENSE.txt for details
+ */
+
+#include "benchmark.hpp"
+
+#include <kfr/dsp/resample.hpp>
+#include <kfr/expressions/basic.hpp>
+#include <kfr/math.hpp>
+#include <kfr/misc/random.hpp>
+
+using namespace kfr;
+using namespace kfr::native;
+
+constexpr size_t block_size = 4096;
+
+template <typename T, size_t quality>
+static void bench_resampler(benchmark::suite& suite, const std::string& name, csize_t<quality> q,
+                            size_t output_sr, size_t input_sr)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+    univector<T> in = typed<T>(gen_random_range(gen, -1.0, +1.0), block_size);
+    univector<T> out(block_size * output_sr / input_sr + 2);
+
+    auto r = resampler(q, output_sr, input_sr, T(1.0), T(0.496));
+    using resampler_type = decltype(r);
+
+    // each output sample is a dot product over depth taps, ns/sample is per input sample
+    const double output_samples = double(block_size) * output_sr / input_sr;
+    suite.run(name, double(output_sr) / input_sr, block_size, 2.0 * resampler_type::depth * output_samples,
+              [&]() {
+                  r(out.data(), in);
+                  benchmark::clobber(out.data());
+              });
+}
+
+template <typename T>
+static void bench_resampler_group(benchmark::suite& suite, size_t output_sr, size_t input_sr)
+{
+    bench_resampler<T>(suite, "draft", resample_quality::draft, output_sr, input_sr);
+    bench_resampler<T>(suite, "low", resample_quality::low, output_sr, input_sr);
+    bench_resampler<T>(suite, "normal", resample_quality::normal, output_sr, input_sr);
+    bench_resampler<T>(suite, "high", resample_quality::high, output_sr, input_sr);
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::suite suite("resampler_bench", argc, argv);
+
+    const size_t rates[][2] = { { 44100, 96000 }, { 44100, 48000 }, { 48000, 96000 },
+                                { 48000, 44100 }, { 96000, 48000 }, { 96000, 44100 } };
+
+    suite.group("resampler_f32", "output/input rate");
+    for (const auto& rate : rates)
+        bench_resampler_group<float>(suite, rate[0], rate[1]);
+
+    suite.group("resampler_f64", "output/input rate");
+    for (const auto& rate : rates)
+        bench_resampler_group<double>(suite, rate[0], rate[1]);
+
+    return suite.finish();
+}
@@ -63,6 +63,7 @@
 #include "misc/random.hpp"
 #include "misc/small_buffer.hpp"
 #include "misc/sort.hpp"
+#include "misc/thread_pool.hpp"
 
 #include "data/bitrev.hpp"
 #include "data/sincos.hpp"
@@ -85,7 +86,12 @@
 #include "vec.hpp"
 
 #include "dft/bitrev.hpp"
+#include "dft/cache.hpp"
 #include "dft/conv.hpp"
+#include "dft/czt.hpp"
+#include "dft/dct.hpp"
 #include "dft/fft.hpp"
 #include "dft/ft.hpp"
+#include "dft/pruned.hpp"
 #include "dft/reference_dft.hpp"
+#include "dft/stft.hpp"
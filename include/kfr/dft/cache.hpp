@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2016 D Levin (http://www.kfrlib.com)
+ * This file is part of KFR
+ *
+ * KFR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFR is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KFR.
+ *
+ * If GPL is not suitable for your project, you must purchase a commercial license to use KFR.
+ * Buying a commercial license is mandatory as soon as you develop commercial activities without
+ * disclosing the source code of your own applications.
+ * See http://www.kfrlib.com for details.
+ */
+#pragma once
+
+#include "fft.hpp"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace kfr
+{
+
+struct dft_cache_stats
+{
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t plans;
+    size_t memory;
+};
+
+/// Process-wide registry of immutable plans shared between callers. Least recently used plans
+/// are released once the number of plans or their total data size exceeds the limits. All
+/// member functions are thread-safe. Plan is dft_plan<T> or dft_plan_real<T>, each type has
+/// its own registry
+template <typename T, typename Plan = dft_plan<T>>
+struct dft_cache
+{
+    using plan_ptr = std::shared_ptr<const Plan>;
+
+    static dft_cache& instance()
+    {
+        static dft_cache cache;
+        return cache;
+    }
+
+    template <bool direct = true, bool inverse = true>
+    plan_ptr get(size_t size, cbools_t<direct, inverse> type = dft_type::both)
+    {
+        const key_type key(size, direct, inverse);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = index.find(key);
+            if (it != index.end())
+            {
+                lru.splice(lru.begin(), lru, it->second);
+                hits++;
+                return it->second->plan;
+            }
+            misses++;
+        }
+        // plans are built outside of the lock, a concurrent miss for the same key keeps the first plan
+        plan_ptr plan = std::make_shared<const Plan>(size, type);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end())
+        {
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->plan;
+        }
+        lru.push_front(entry{ key, plan, plan->data_size_bytes() });
+        index[key] = lru.begin();
+        memory += plan->data_size_bytes();
+        evict();
+        return plan;
+    }
+
+    /// 0 means no limit
+    void set_limits(size_t max_plans, size_t max_memory)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->max_plans  = max_plans;
+        this->max_memory = max_memory;
+        evict();
+    }
+
+    dft_cache_stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return dft_cache_stats{ hits, misses, evictions, lru.size(), memory };
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lru.clear();
+        index.clear();
+        memory = 0;
+    }
+
+    void reset_stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        hits      = 0;
+        misses    = 0;
+        evictions = 0;
+    }
+
+private:
+    using key_type = std::tuple<size_t, bool, bool>;
+    struct entry
+    {
+        key_type key;
+        plan_ptr plan;
+        size_t memory;
+    };
+
+    dft_cache() = default;
+
+    // the most recently used plan is kept even if it alone exceeds the limits
+    void evict()
+    {
+        while (lru.size() > 1 &&
+               ((max_plans && lru.size() > max_plans) || (max_memory && memory > max_memory)))
+        {
+            memory -= lru.back().memory;
+            index.erase(lru.back().key);
+            lru.pop_back();
+            evictions++;
+        }
+    }
+
+    mutable std::mutex mutex;
+    std::list<entry> lru;
+    std::map<key_type, typename std::list<entry>::iterator> index;
+    size_t max_plans  = 64;
+    size_t max_memory = 0;
+    size_t memory     = 0;
+    size_t hits       = 0;
+    size_t misses     = 0;
+    size_t evictions  = 0;
+};
+
+/// Returns a shared plan from the process-wide cache
+template <typename T, bool direct = true, bool inverse = true>
+std::shared_ptr<const dft_plan<T>> cached_dft_plan(size_t size, cbools_t<direct, inverse> type = dft_type::both)
+{
+    return dft_cache<T>::instance().get(size, type);
+}
+
+/// Returns a shared real-input plan from the process-wide cache
+template <typename T, bool direct = true, bool inverse = true>
+std::shared_ptr<const dft_plan_real<T>> cached_dft_plan_real(size_t size,
+                                                             cbools_t<direct, inverse> type = dft_type::both)
+{
+    return dft_cache<T, dft_plan_real<T>>::instance().get(size, type);
+}
+}
@@ -27,10 +27,22 @@
 #include "../base/memory.hpp"
 #include "../base/read_write.hpp"
 #include "../base/vec.hpp"
+#include "../dsp/fir.hpp"
 #include "../expressions/operators.hpp"
 
+#include "cache.hpp"
 #include "fft.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #pragma clang diagnostic push
 #if CID_HAS_WARNING("-Wshadow")
 #pragma clang diagnostic ignored "-Wshadow"
@@ -39,21 +51,850 @@
 namespace kfr
 {
 
+enum class convolve_method
+{
+    automatic,
+    direct,       // SIMD multiply-add of the input with each tap
+    overlap_save, // blocks of a real DFT shorter than the output
+    fft           // one real DFT holding the whole output
+};
+
+namespace internal
+{
+// Transform size used by the fft method for inputs of size1 and size2
+inline size_t convolve_fft_size(size_t size1, size_t size2)
+{
+    return std::max(size_t(2), next_poweroftwo(size1 + size2 - 1));
+}
+
+// out[i] += in[i] * scale
+template <typename T>
+KFR_INTRIN void multiply_accumulate(T* out, const T* in, T scale, size_t size)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native> * 2;
+    size_t i               = 0;
+    KFR_LOOP_NOUNROLL
+    for (; i + width <= size; i += width)
+        write(out + i, read<width>(out + i) + read<width>(in + i) * scale);
+    KFR_LOOP_NOUNROLL
+    for (; i < size; i++)
+        out[i] += in[i] * scale;
+}
+
+// Samples [first, first + count) of the linear convolution of src1 and src2 (src2 read backwards if
+// reversed). Taps are applied one at a time to blocks of the output that stay in the L1 cache
+template <typename T>
+void convolve_direct(T* out, const T* src1, size_t size1, const T* src2, size_t size2, bool reversed,
+                     size_t first, size_t count)
+{
+    constexpr size_t block = 2048;
+    builtin_memset(out, 0, sizeof(T) * count);
+    for (size_t b = 0; b < count; b += block)
+    {
+        const size_t block_end = std::min(count, b + block);
+        for (size_t k = 0; k < size2; k++)
+        {
+            // out[i] += h[k] * src1[first + i - k] where 0 <= first + i - k < size1
+            const size_t begin = std::max(b, k > first ? k - first : 0);
+            if (first + begin >= size1 + k)
+                continue;
+            const size_t end = std::min(block_end, size1 + k - first);
+            if (begin < end)
+                multiply_accumulate(out + begin, src1 + first + begin - k,
+                                    reversed ? src2[size2 - 1 - k] : src2[k], end - begin);
+        }
+    }
+}
+
+// Real plan with unordered execution enabled, cached apart from the ordinary real plans
+template <typename T>
+struct dft_plan_real_unordered : dft_plan_real<T>
+{
+    template <bool direct = true, bool inverse = true>
+    dft_plan_real_unordered(size_t size, cbools_t<direct, inverse> type = dft_type::both)
+        : dft_plan_real<T>(size, type)
+    {
+        this->enable_unordered();
+    }
+};
+
+// Plan of the fft and overlap-save methods, spectra are only multiplied so their order is free
+template <typename T>
+std::shared_ptr<const dft_plan_real<T>> cached_convolve_plan(size_t size)
+{
+    return dft_cache<T, dft_plan_real_unordered<T>>::instance().get(size);
+}
+
+// Size of temp for the transforms of size fft_size used by the fft and overlap-save methods
+template <typename T>
+size_t convolve_fft_temp_size(size_t fft_size)
+{
+    return align_up(sizeof(T) * fft_size, native_cache_alignment) +
+           2 * align_up(sizeof(complex<T>) * (fft_size / 2 + 1), native_cache_alignment) +
+           cached_convolve_plan<T>(fft_size)->temp_size;
+}
+
+// x[i] = x[i] * y[i] * scale
+template <typename T>
+KFR_INTRIN void cmul_scale(complex<T>* x, const complex<T>* y, T scale, size_t size)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    size_t i               = 0;
+    KFR_LOOP_NOUNROLL
+    for (; i + width <= size; i += width)
+        cwrite<width>(x + i, cmul(cread<width>(x + i), cread<width>(y + i)) * scale);
+    KFR_LOOP_NOUNROLL
+    for (; i < size; i++)
+        cwrite<1>(x + i, cmul(cread<1>(x + i), cread<1>(y + i)) * scale);
+}
+
+// Writes src[offset, offset + size) to padded[0, size), zeros outside of [0, src_size)
+template <typename T>
+void convolve_pad(T* padded, size_t size, const T* src, size_t src_size, ptrdiff_t offset, bool reversed)
+{
+    builtin_memset(padded, 0, sizeof(T) * size);
+    const ptrdiff_t begin = std::max(ptrdiff_t(0), -offset);
+    const ptrdiff_t end   = std::min(ptrdiff_t(size), ptrdiff_t(src_size) - offset);
+    if (begin >= end)
+        return;
+    if (reversed)
+        std::reverse_copy(src + src_size - (offset + end), src + src_size - (offset + begin), padded + begin);
+    else
+        builtin_memcpy(padded + begin, src + offset + begin, sizeof(T) * (end - begin));
+}
+
+// Samples [first, first + count) of the linear convolution through real DFTs of plan.size. The
+// kernel src2 is transformed once, each block of plan.size - size2 + 1 outputs takes one direct and
+// one inverse transform of the input around it (overlap-save). When plan.size holds the whole
+// output a single circular convolution is used, the fft method
+template <typename T>
+void convolve_overlap_save(T* out, const T* src1, size_t size1, const T* src2, size_t size2, bool reversed,
+                           size_t first, size_t count, const dft_plan_real<T>& plan, u8* temp)
+{
+    const size_t size = plan.size;
+    const size_t bins = size / 2 + 1;
+    const size_t step = size - size2 + 1;
+    T* padded         = ptr_cast<T>(temp);
+    temp += align_up(sizeof(T) * size, native_cache_alignment);
+    complex<T>* kernel = ptr_cast<complex<T>>(temp);
+    temp += align_up(sizeof(complex<T>) * bins, native_cache_alignment);
+    complex<T>* spectrum = ptr_cast<complex<T>>(temp);
+    temp += align_up(sizeof(complex<T>) * bins, native_cache_alignment);
+
+    convolve_pad(padded, size, src2, size2, 0, reversed);
+    plan.execute_unordered(kernel, padded, temp);
+
+    // the inverse transform is unnormalized
+    const T scale = T(1) / T(size);
+    if (size >= size1 + size2 - 1)
+    {
+        // the circular convolution holds the whole linear one
+        convolve_pad(padded, size, src1, size1, 0, false);
+        plan.execute_unordered(spectrum, padded, temp);
+        cmul_scale(spectrum, kernel, scale, bins);
+        plan.execute_unordered(padded, spectrum, temp);
+        builtin_memcpy(out, padded + first, sizeof(T) * count);
+        return;
+    }
+    for (size_t done = 0; done < count; done += step)
+    {
+        // outputs [p, p + step) need the input [p - size2 + 1, p + step), they land at size2 - 1
+        const size_t p = first + done;
+        convolve_pad(padded, size, src1, size1, ptrdiff_t(p) - ptrdiff_t(size2 - 1), false);
+        plan.execute_unordered(spectrum, padded, temp);
+        cmul_scale(spectrum, kernel, scale, bins);
+        plan.execute_unordered(padded, spectrum, temp);
+        builtin_memcpy(out + done, padded + size2 - 1, sizeof(T) * std::min(step, count - done));
+    }
+}
+
+// Best time of a few runs of fn that take about 2 ms
+template <typename Fn>
+double time_ns(Fn&& fn)
+{
+    using clock = std::chrono::steady_clock;
+    fn();
+    double best      = std::numeric_limits<double>::max();
+    size_t runs      = 0;
+    const auto start = clock::now();
+    do
+    {
+        const auto run_start = clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::nano>(clock::now() - run_start).count());
+        runs++;
+    } while (runs < 4 || std::chrono::duration<double>(clock::now() - start).count() < 0.002);
+    return best;
+}
+}
+
+/// Time estimates of the convolution methods, scaled by coefficients measured on this machine for
+/// type T the first time instance() is called
+template <typename T>
+struct convolve_cost_model
+{
+    double direct_tap;    // ns per output sample and tap
+    double transform;     // ns per N * log2(N) of a real DFT of size N
+    double spectrum_bin;  // ns per bin of the spectrum product
+
+    static const convolve_cost_model& instance()
+    {
+        static const convolve_cost_model model = measure();
+        return model;
+    }
+
+    double direct_cost(size_t size1, size_t size2) const
+    {
+        return direct_tap * double(size1 + size2 - 1) * double(size2);
+    }
+    double fft_cost(size_t size1, size_t size2) const
+    {
+        const size_t fft_size = internal::convolve_fft_size(size1, size2);
+        return transform * double(fft_size) * std::log2(double(fft_size)) * 3 +
+               spectrum_bin * double(fft_size / 2 + 1);
+    }
+    double overlap_save_cost(size_t size1, size_t size2, size_t fft_size) const
+    {
+        const size_t step    = fft_size - size2 + 1;
+        const double blocks  = double((size1 + size2 - 1 + step - 1) / step);
+        const double dft     = transform * double(fft_size) * std::log2(double(fft_size));
+        const double product = spectrum_bin * double(fft_size / 2 + 1);
+        return dft * (1 + 2 * blocks) + product * blocks;
+    }
+
+    /// Transform size of the overlap-save method, the cheapest of 2 to 16 times the kernel
+    size_t overlap_save_size(size_t size1, size_t size2) const
+    {
+        size_t best = std::max(size_t(4), next_poweroftwo(size2 * 2));
+        for (size_t fft_size = best * 2; fft_size <= best * 8; fft_size *= 2)
+            if (overlap_save_cost(size1, size2, fft_size) < overlap_save_cost(size1, size2, best))
+                best = fft_size;
+        return best;
+    }
+
+    /// The cheapest method for inputs of size1 and size2, never convolve_method::automatic
+    convolve_method select(size_t size1, size_t size2) const
+    {
+        const size_t fft_size   = internal::convolve_fft_size(size1, size2);
+        const size_t block_size = overlap_save_size(size1, size2);
+        const double direct     = direct_cost(size1, size2);
+        const double fft        = fft_cost(size1, size2);
+        const double blocks     = block_size < fft_size ? overlap_save_cost(size1, size2, block_size) : fft;
+        if (direct <= fft && direct <= blocks)
+            return convolve_method::direct;
+        return blocks < fft ? convolve_method::overlap_save : convolve_method::fft;
+    }
+
+    /// Times the direct loop and a real DFT of 4096 points
+    static convolve_cost_model measure()
+    {
+        constexpr size_t size = 4096;
+        constexpr size_t taps = 32;
+        const size_t bins     = size / 2 + 1;
+        univector<T> x(size, T(0.5)), h(taps, T(0.25)), y(size + taps - 1);
+        univector<complex<T>> spectrum1(bins), spectrum2(bins, complex<T>(T(0.6), T(0.8)));
+        const auto plan = internal::cached_convolve_plan<T>(size);
+        univector<u8> temp(plan->temp_size);
+
+        convolve_cost_model model;
+        model.direct_tap = internal::time_ns([&]() {
+                               internal::convolve_direct(y.data(), x.data(), size, h.data(), taps, false, 0,
+                                                         y.size());
+                           }) /
+                           double(y.size() * taps);
+        model.transform = internal::time_ns([&]() {
+                              plan->execute_unordered(spectrum1.data(), x.data(), temp.data());
+                              plan->execute_unordered(x.data(), spectrum1.data(), temp.data());
+                              x = scalar(T(0.5));
+                          }) /
+                          (2.0 * size * std::log2(double(size)));
+        model.spectrum_bin = internal::time_ns([&]() {
+                                 internal::cmul_scale(spectrum1.data(), spectrum2.data(), T(1), bins);
+                             }) /
+                             double(bins);
+        return model;
+    }
+};
+
+namespace internal
+{
+template <typename T>
+convolve_method convolve_resolve(size_t size1, size_t size2, convolve_method method)
+{
+    return method == convolve_method::automatic ? convolve_cost_model<T>::instance().select(size1, size2)
+                                                : method;
+}
+
+template <typename T>
+size_t convolve_method_fft_size(size_t size1, size_t size2, convolve_method method)
+{
+    return method == convolve_method::overlap_save
+               ? convolve_cost_model<T>::instance().overlap_save_size(size1, size2)
+               : convolve_fft_size(size1, size2);
+}
+
+template <typename T>
+void convolve_impl(T* out, const T* src1, size_t size1, const T* src2, size_t size2, bool reversed, size_t first,
+                   size_t count, u8* temp, convolve_method method)
+{
+    if (size1 == 0 || size2 == 0)
+        return;
+    method = convolve_resolve<T>(size1, size2, method);
+    if (method == convolve_method::direct)
+    {
+        convolve_direct(out, src1, size1, src2, size2, reversed, first, count);
+        return;
+    }
+    const auto plan = cached_convolve_plan<T>(convolve_method_fft_size<T>(size1, size2, method));
+    convolve_overlap_save(out, src1, size1, src2, size2, reversed, first, count, *plan, temp);
+}
+}
+
+/// Size in bytes of the temporary buffer for convolve and correlate of inputs of size1 and size2,
+/// or autocorrelate of an input of size1 (size2 = size1). The direct method needs none
+template <typename T>
+size_t convolve_temp_size(size_t size1, size_t size2, convolve_method method = convolve_method::automatic)
+{
+    if (size1 == 0 || size2 == 0)
+        return 0;
+    method = internal::convolve_resolve<T>(size1, size2, method);
+    return method == convolve_method::direct
+               ? 0
+               : internal::convolve_fft_temp_size<T>(internal::convolve_method_fft_size<T>(size1, size2, method));
+}
+
+/// Writes size1 + size2 - 1 samples of the linear convolution of src1 and src2 to out. The
+/// automatic method picks the cheapest one by convolve_cost_model. Plans are taken from the
+/// process-wide cache and temp must hold convolve_temp_size<T>(size1, size2, method) bytes, so
+/// nothing is allocated once the plan is cached
+template <typename T>
+void convolve(T* out, const T* src1, size_t size1, const T* src2, size_t size2, u8* temp,
+              convolve_method method = convolve_method::automatic)
+{
+    internal::convolve_impl(out, src1, size1, src2, size2, false, 0, size1 + size2 - 1, temp, method);
+}
+
+/// Writes size1 + size2 - 1 samples of the cross-correlation out[k] = sum src1[n + k - size2 + 1] * src2[n]
+/// to out; out[size2 - 1] is lag 0. temp is as for convolve
+template <typename T>
+void correlate(T* out, const T* src1, size_t size1, const T* src2, size_t size2, u8* temp,
+               convolve_method method = convolve_method::automatic)
+{
+    internal::convolve_impl(out, src1, size1, src2, size2, true, 0, size1 + size2 - 1, temp, method);
+}
+
+/// Writes size samples of the autocorrelation of src for lags 0 to size - 1 to out. temp must hold
+/// convolve_temp_size<T>(size, size, method) bytes
+template <typename T>
+void autocorrelate(T* out, const T* src, size_t size, u8* temp, convolve_method method = convolve_method::automatic)
+{
+    internal::convolve_impl(out, src, size, src, size, true, size - 1, size, temp, method);
+}
+
+template <typename T, size_t Tag1, size_t Tag2, size_t Tag3, size_t Tag4>
+void convolve(univector<T, Tag1>& out, const univector<T, Tag2>& src1, const univector<T, Tag3>& src2,
+              univector<u8, Tag4>& temp, convolve_method method = convolve_method::automatic)
+{
+    convolve(out.data(), src1.data(), src1.size(), src2.data(), src2.size(), temp.data(), method);
+}
+template <typename T, size_t Tag1, size_t Tag2, size_t Tag3, size_t Tag4>
+void correlate(univector<T, Tag1>& out, const univector<T, Tag2>& src1, const univector<T, Tag3>& src2,
+               univector<u8, Tag4>& temp, convolve_method method = convolve_method::automatic)
+{
+    correlate(out.data(), src1.data(), src1.size(), src2.data(), src2.size(), temp.data(), method);
+}
+template <typename T, size_t Tag1, size_t Tag2, size_t Tag3>
+void autocorrelate(univector<T, Tag1>& out, const univector<T, Tag2>& src, univector<u8, Tag3>& temp,
+                   convolve_method method = convolve_method::automatic)
+{
+    autocorrelate(out.data(), src.data(), src.size(), temp.data(), method);
+}
+
 template <typename T, size_t Tag1, size_t Tag2>
-KFR_INTRIN univector<T> convolve(const univector<T, Tag1>& src1, const univector<T, Tag2>& src2)
-{
-    const size_t size                = next_poweroftwo(src1.size() + src2.size() - 1);
-    univector<complex<T>> src1padded = src1;
-    univector<complex<T>> src2padded = src2;
-    src1padded.resize(size, 0);
-    src2padded.resize(size, 0);
-    dft_plan<T> plan(size);
-    univector<u8> temp(plan.temp_size);
-    plan.execute(src1padded, src1padded, temp);
-    plan.execute(src2padded, src2padded, temp);
-    src1padded = src1padded * src2padded;
-    plan.execute(src1padded, src1padded, temp, true);
-    return typed<T>( real(src1padded), src1.size() + src2.size() - 1 ) / T(size);
+KFR_INTRIN univector<T> convolve(const univector<T, Tag1>& src1, const univector<T, Tag2>& src2,
+                                 convolve_method method = convolve_method::automatic)
+{
+    univector<T> out(src1.size() + src2.size() - 1);
+    univector<u8> temp(convolve_temp_size<T>(src1.size(), src2.size(), method));
+    convolve(out, src1, src2, temp, method);
+    return out;
+}
+template <typename T, size_t Tag1, size_t Tag2>
+KFR_INTRIN univector<T> correlate(const univector<T, Tag1>& src1, const univector<T, Tag2>& src2,
+                                  convolve_method method = convolve_method::automatic)
+{
+    univector<T> out(src1.size() + src2.size() - 1);
+    univector<u8> temp(convolve_temp_size<T>(src1.size(), src2.size(), method));
+    correlate(out, src1, src2, temp, method);
+    return out;
+}
+template <typename T, size_t Tag>
+KFR_INTRIN univector<T> autocorrelate(const univector<T, Tag>& src,
+                                      convolve_method method = convolve_method::automatic)
+{
+    univector<T> out(src.size());
+    univector<u8> temp(convolve_temp_size<T>(src.size(), src.size(), method));
+    autocorrelate(out, src, temp, method);
+    return out;
+}
+
+namespace internal
+{
+// acc[i] += x[i] * y[i]
+template <typename T>
+KFR_INTRIN void cmul_accumulate(complex<T>* acc, const complex<T>* x, const complex<T>* y, size_t size)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    size_t i               = 0;
+    KFR_LOOP_NOUNROLL
+    for (; i + width <= size; i += width)
+        cwrite<width>(acc + i, cread<width>(acc + i) + cmul(cread<width>(x + i), cread<width>(y + i)));
+    KFR_LOOP_NOUNROLL
+    for (; i < size; i++)
+        cwrite<1>(acc + i, cread<1>(acc + i) + cmul(cread<1>(x + i), cread<1>(y + i)));
+}
+
+// Overlap-save convolution of blocks of block_size samples with an impulse response split into
+// partitions of block_size taps. The spectrum of each partition (real DFT of 2 * block_size) is
+// multiplied with the spectrum of the input block as many blocks ago, kept in a frequency-domain
+// delay line
+template <typename T>
+struct partitioned_convolution
+{
+    partitioned_convolution(const T* impulse, size_t length, size_t block_size)
+        : block_size(block_size), partitions(std::max(size_t(1), (length + block_size - 1) / block_size)),
+          bins(block_size + 1), current(0), plan(block_size * 2), ir_spectra(partitions * bins),
+          fdl(partitions * bins), accumulator(bins), output_window(block_size * 2), temp(plan.temp_size)
+    {
+        // spectra are only multiplied and accumulated, so they are kept in the order of the plan
+        plan.enable_unordered();
+        // the inverse transform is unnormalized, 1 / (2 * block_size) is folded into the partitions
+        const T scale = T(1) / T(block_size * 2);
+        for (size_t p = 0; p < partitions; p++)
+        {
+            builtin_memset(output_window.data(), 0, sizeof(T) * block_size * 2);
+            for (size_t i = p * block_size; i < std::min(length, (p + 1) * block_size); i++)
+                output_window[i - p * block_size] = impulse[i] * scale;
+            plan.execute_unordered(ir_spectra.data() + p * bins, output_window.data(), temp.data());
+        }
+        reset();
+    }
+
+    // window holds the previous and the current input block, block_size samples are written to output
+    void process(T* output, const T* window)
+    {
+        // the newest spectrum replaces the oldest one, partition p meets the input from p blocks ago
+        current = current == 0 ? partitions - 1 : current - 1;
+        plan.execute_unordered(fdl.data() + current * bins, window, temp.data());
+
+        builtin_memset(accumulator.data(), 0, sizeof(complex<T>) * bins);
+        size_t slot = current;
+        for (size_t p = 0; p < partitions; p++)
+        {
+            cmul_accumulate(accumulator.data(), fdl.data() + slot * bins, ir_spectra.data() + p * bins, bins);
+            slot = slot + 1 == partitions ? 0 : slot + 1;
+        }
+
+        // the first half is circularly aliased, the second one is the output
+        plan.execute_unordered(output_window.data(), accumulator.data(), temp.data());
+        builtin_memcpy(output, output_window.data() + block_size, sizeof(T) * block_size);
+    }
+
+    void reset()
+    {
+        builtin_memset(fdl.data(), 0, sizeof(complex<T>) * fdl.size());
+        current = 0;
+    }
+
+    size_t block_size;
+    size_t partitions;
+    size_t bins;
+    size_t current;
+    dft_plan_real<T> plan;
+    univector<complex<T>> ir_spectra;
+    univector<complex<T>> fdl;
+    univector<complex<T>> accumulator;
+    univector<T> output_window;
+    univector<u8> temp;
+};
+}
+
+/// Streaming convolution with a fixed impulse response by uniformly partitioned overlap-save.
+/// Samples are passed in any count, the output is delayed by block_size samples. A power of two
+/// block_size is the fastest
+template <typename T>
+struct convolver
+{
+    template <size_t Tag>
+    convolver(const univector<T, Tag>& impulse, size_t block_size = 1024)
+        : block_size(block_size), position(0), core(impulse.data(), impulse.size(), block_size),
+          input_window(block_size * 2), output_block(block_size)
+    {
+        reset();
+    }
+
+    size_t latency() const { return block_size; }
+
+    /// Filters count samples, input and output may point to the same buffer
+    void process(T* output, const T* input, size_t count)
+    {
+        while (count)
+        {
+            const size_t part = std::min(count, block_size - position);
+            builtin_memcpy(input_window.data() + block_size + position, input, sizeof(T) * part);
+            builtin_memcpy(output, output_block.data() + position, sizeof(T) * part);
+            position += part;
+            input += part;
+            output += part;
+            count -= part;
+            if (position == block_size)
+            {
+                core.process(output_block.data(), input_window.data());
+                builtin_memcpy(input_window.data(), input_window.data() + block_size, sizeof(T) * block_size);
+                position = 0;
+            }
+        }
+    }
+    template <size_t Tag1, size_t Tag2>
+    void process(univector<T, Tag1>& output, const univector<T, Tag2>& input)
+    {
+        process(output.data(), input.data(), std::min(output.size(), input.size()));
+    }
+
+    void reset()
+    {
+        core.reset();
+        builtin_memset(input_window.data(), 0, sizeof(T) * input_window.size());
+        builtin_memset(output_block.data(), 0, sizeof(T) * output_block.size());
+        position = 0;
+    }
+
+private:
+    size_t block_size;
+    size_t position;
+    internal::partitioned_convolution<T> core;
+    univector<T> input_window;
+    univector<T> output_block;
+};
+
+/// Streaming convolution for long impulse responses with non-uniform partitions. The head of the
+/// impulse response is convolved in the calling thread in blocks of block_size samples, the tail
+/// is split into levels whose block size grows by 4 up to max_block_size. A level with blocks of
+/// B taps starts at tap 2 * B - block_size, so each of its blocks has one block period between the
+/// moment its input is complete and the moment its output is due. The levels are computed in that
+/// time on a worker thread, earliest deadline first, and the calling thread only waits if a deadline
+/// is missed. The output is delayed by block_size samples. With background = false the tail is
+/// computed in the calling thread instead
+template <typename T>
+struct nonuniform_convolver
+{
+    template <size_t Tag>
+    nonuniform_convolver(const univector<T, Tag>& impulse, size_t block_size = 64, size_t max_block_size = 8192,
+                         bool background = true)
+        : block_size(block_size), position(0), time(0),
+          head(impulse.data(), head_length(impulse.size(), block_size, max_block_size), block_size),
+          input_window(block_size * 2), output_block(block_size), stopping(false)
+    {
+        size_t offset = head_length(impulse.size(), block_size, max_block_size);
+        for (size_t level_block = block_size * 4; offset < impulse.size(); level_block *= 4)
+        {
+            const size_t end = level_block * 4 > max_block_size
+                                   ? impulse.size()
+                                   : std::min(impulse.size(), level_block * 8 - block_size);
+            levels.emplace_back(new level(impulse.data() + offset, end - offset, level_block));
+            offset = end;
+        }
+        reset();
+        if (background && !levels.empty())
+            worker = std::thread([this]() { run_worker(); });
+    }
+    ~nonuniform_convolver()
+    {
+        if (!worker.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start.notify_one();
+        worker.join();
+    }
+
+    size_t latency() const { return block_size; }
+
+    /// Filters count samples, input and output may point to the same buffer
+    void process(T* output, const T* input, size_t count)
+    {
+        while (count)
+        {
+            const size_t part = std::min(count, block_size - position);
+            builtin_memcpy(input_window.data() + block_size + position, input, sizeof(T) * part);
+            builtin_memcpy(output, output_block.data() + position, sizeof(T) * part);
+            position += part;
+            input += part;
+            output += part;
+            count -= part;
+            if (position == block_size)
+            {
+                process_block();
+                position = 0;
+            }
+        }
+    }
+    template <size_t Tag1, size_t Tag2>
+    void process(univector<T, Tag1>& output, const univector<T, Tag2>& input)
+    {
+        process(output.data(), input.data(), std::min(output.size(), input.size()));
+    }
+
+    void reset()
+    {
+        for (const std::unique_ptr<level>& l : levels)
+        {
+            wait(*l);
+            l->core.reset();
+            builtin_memset(l->window.data(), 0, sizeof(T) * l->window.size());
+            builtin_memset(l->result.data(), 0, sizeof(T) * l->result.size());
+            builtin_memset(l->playing.data(), 0, sizeof(T) * l->playing.size());
+            l->position      = 0;
+            l->play_position = 0;
+        }
+        head.reset();
+        builtin_memset(input_window.data(), 0, sizeof(T) * input_window.size());
+        builtin_memset(output_block.data(), 0, sizeof(T) * output_block.size());
+        position = 0;
+        time     = 0;
+    }
+
+private:
+    struct level
+    {
+        level(const T* impulse, size_t length, size_t block_size)
+            : block_size(block_size), position(0), play_position(0), deadline(0), pending(false),
+              core(impulse, length, block_size), window(block_size * 2), job_window(block_size * 2),
+              result(block_size), playing(block_size)
+        {
+        }
+        size_t block_size;
+        size_t position;
+        size_t play_position;
+        u64 deadline;
+        bool pending;
+        internal::partitioned_convolution<T> core;
+        univector<T> window;
+        univector<T> job_window;
+        univector<T> result;
+        univector<T> playing;
+    };
+
+    static size_t head_length(size_t size, size_t block_size, size_t max_block_size)
+    {
+        return block_size * 4 > max_block_size ? size : std::min(size, block_size * 7);
+    }
+
+    void process_block()
+    {
+        head.process(output_block.data(), input_window.data());
+        time += block_size;
+        for (const std::unique_ptr<level>& l : levels)
+        {
+            builtin_memcpy(l->window.data() + l->block_size + l->position, input_window.data() + block_size,
+                           sizeof(T) * block_size);
+            l->position += block_size;
+            if (l->position == l->block_size)
+            {
+                // the previous block is due now, the current one is due one block period later
+                wait(*l);
+                l->result.swap(l->playing);
+                l->play_position = 0;
+                builtin_memcpy(l->job_window.data(), l->window.data(), sizeof(T) * l->block_size * 2);
+                submit(*l);
+                builtin_memcpy(l->window.data(), l->window.data() + l->block_size, sizeof(T) * l->block_size);
+                l->position = 0;
+            }
+            output_block = output_block + l->playing.slice(l->play_position, block_size);
+            l->play_position += block_size;
+        }
+        builtin_memcpy(input_window.data(), input_window.data() + block_size, sizeof(T) * block_size);
+    }
+
+    void submit(level& l)
+    {
+        if (!worker.joinable())
+        {
+            l.core.process(l.result.data(), l.job_window.data());
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            l.pending  = true;
+            l.deadline = time + l.block_size;
+        }
+        start.notify_one();
+    }
+
+    void wait(level& l)
+    {
+        if (!worker.joinable())
+            return;
+        std::unique_lock<std::mutex> lock(mutex);
+        finish.wait(lock, [&l]() { return !l.pending; });
+    }
+
+    level* earliest_job() const
+    {
+        level* job = nullptr;
+        for (const std::unique_ptr<level>& l : levels)
+            if (l->pending && (!job || l->deadline < job->deadline))
+                job = l.get();
+        return job;
+    }
+
+    void run_worker()
+    {
+        for (;;)
+        {
+            level* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [&]() { return stopping || (job = earliest_job()) != nullptr; });
+                if (stopping)
+                    return;
+            }
+            job->core.process(job->result.data(), job->job_window.data());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job->pending = false;
+            }
+            finish.notify_all();
+        }
+    }
+
+    size_t block_size;
+    size_t position;
+    u64 time;
+    internal::partitioned_convolution<T> head;
+    univector<T> input_window;
+    univector<T> output_block;
+    std::vector<std::unique_ptr<level>> levels;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable finish;
+    bool stopping;
+};
+
+/// FIR filter for long impulse responses with the same output as fir_filter and no latency. The
+/// first block_size taps are applied directly, the remaining ones by a convolver with blocks of
+/// block_size samples, whose delay of block_size samples is exactly the position of these taps.
+/// The default block_size balances block_size direct taps per sample against the per-sample cost
+/// of the transforms and of the tail partitions
+template <typename T>
+struct fft_fir_filter : filter<T>
+{
+    template <size_t Tag>
+    fft_fir_filter(const univector<T, Tag>& taps, size_t block_size = 0)
+        : tapcount(taps.size()), block_size(block_size ? block_size : default_block_size(taps.size())),
+          head(univector<T>(taps.slice(0, this->block_size))), tail(tail_taps(taps, this->block_size)),
+          tail_output(this->block_size)
+    {
+    }
+
+    size_t size() const { return tapcount; }
+
+    using filter<T>::process;
+
+    void process(T* out, const T* in, size_t count) override
+    {
+        while (count)
+        {
+            const size_t part = std::min(count, block_size);
+            // the tail reads the input before the head may overwrite it in place
+            tail.process(tail_output.data(), in, part);
+            head.process(out, in, part);
+            make_univector(out, part) = make_univector(out, part) + tail_output.slice(0, part);
+            in += part;
+            out += part;
+            count -= part;
+        }
+    }
+
+    void reset() override
+    {
+        head.reset();
+        tail.reset();
+    }
+
+    static size_t default_block_size(size_t tapcount)
+    {
+        const size_t size = next_poweroftwo(size_t(std::sqrt(3.0 * tapcount)));
+        return std::min(std::max(size, size_t(32)), size_t(4096));
+    }
+
+private:
+    // a single zero tap if the head covers all taps
+    template <size_t Tag>
+    static univector<T> tail_taps(const univector<T, Tag>& taps, size_t block_size)
+    {
+        if (taps.size() <= block_size)
+            return univector<T>(1, T(0));
+        return univector<T>(taps.slice(block_size));
+    }
+
+    size_t tapcount;
+    size_t block_size;
+    fir_filter<T> head;
+    convolver<T> tail;
+    univector<T> tail_output;
+};
+
+namespace internal
+{
+// Smallest power-of-two tap count for which fft_fir_filter beats fir_filter. Symmetric taps are
+// a triangle and take the folded kernel, the others a ramp that fir_filter cannot fold
+template <typename T>
+size_t measure_fft_fir_crossover(bool symmetric)
+{
+    constexpr size_t length = 8192;
+    univector<T> in(length, T(0.5)), out(length);
+    for (size_t tapcount = 32; tapcount <= 16384; tapcount *= 2)
+    {
+        univector<T> taps(tapcount);
+        for (size_t k = 0; k < tapcount; k++)
+            taps[k] = T(symmetric ? std::min(k, tapcount - 1 - k) + 1 : k + 1) / T(tapcount * tapcount);
+        fir_filter<T> direct(taps);
+        fft_fir_filter<T> fft(taps);
+        const double direct_time = internal::time_ns([&]() { direct.process(out, in); });
+        const double fft_time    = internal::time_ns([&]() { fft.process(out, in); });
+        if (fft_time < direct_time)
+            return tapcount;
+    }
+    return std::numeric_limits<size_t>::max();
+}
+}
+
+/// Number of taps from which fft_fir_filter is faster than fir_filter for type T, measured on this
+/// machine the first time it is called. (Anti)symmetric taps halve the cost of fir_filter, so they
+/// are measured separately
+template <typename T>
+size_t fft_fir_crossover(fir_symmetry symmetry = fir_symmetry::none)
+{
+    if (symmetry == fir_symmetry::none)
+    {
+        static const size_t asymmetric = internal::measure_fft_fir_crossover<T>(false);
+        return asymmetric;
+    }
+    static const size_t symmetric = internal::measure_fft_fir_crossover<T>(true);
+    return symmetric;
+}
+
+/// Creates fir_filter or fft_fir_filter, whichever is faster for the number and symmetry of taps
+template <typename T, size_t Tag>
+std::unique_ptr<filter<T>> make_fir_filter(const univector<T, Tag>& taps)
+{
+    if (taps.size() >= fft_fir_crossover<T>(detect_fir_symmetry(taps.data(), taps.size())))
+        return std::unique_ptr<filter<T>>(new fft_fir_filter<T>(taps));
+    return std::unique_ptr<filter<T>>(new fir_filter<T>(taps));
 }
 }
 #pragma clang diagnostic pop
@@ -0,0 +1,117 @@
+/**
+ * Copyright (C) 2016 D Levin (http://www.kfrlib.com)
+ * This file is part of KFR
+ *
+ * KFR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFR is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KFR.
+ *
+ * If GPL is not suitable for your project, you must purchase a commercial license to use KFR.
+ * Buying a commercial license is mandatory as soon as you develop commercial activities without
+ * disclosing the source code of your own applications.
+ * See http://www.kfrlib.com for details.
+ */
+#pragma once
+
+#include "fft.hpp"
+#include <cmath>
+
+namespace kfr
+{
+
+/// Chirp Z-transform: X[k] = sum x[n] * a^-n * w^(n*k) for k = 0 .. count - 1, that is count points
+/// on the spiral starting at a with ratio w. With n*k = (n^2 + k^2 - (k - n)^2) / 2 the sum becomes
+/// a convolution with the chirp w^(-m^2 / 2), evaluated with a DFT of the next power of two that
+/// holds size + count - 1 points (Bluestein). Costs O((size + count) log(size + count)) for any
+/// count and spacing, instead of O(size * count) for direct evaluation
+template <typename T>
+struct czt_plan
+{
+    size_t size;
+    size_t count;
+    size_t temp_size;
+
+    czt_plan(size_t size, size_t count, complex<T> w, complex<T> a)
+        : czt_plan(size, count, std::log(std::hypot(double(w.real()), double(w.imag()))),
+                   std::atan2(double(w.imag()), double(w.real())),
+                   std::log(std::hypot(double(a.real()), double(a.imag()))),
+                   std::atan2(double(a.imag()), double(a.real())))
+    {
+    }
+
+    /// count bins on the unit circle starting from the normalized frequency first (cycles per
+    /// sample) spaced by step, for example first = 900 / fs and step = 1 / fs for 1 Hz bins from 900 Hz
+    static czt_plan zoom(size_t size, size_t count, double first, double step)
+    {
+        return czt_plan(size, count, 0.0, -c_pi<double, 2> * step, 0.0, c_pi<double, 2> * first);
+    }
+
+    /// Reads size values from in and writes count values to out. temp must hold temp_size bytes
+    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp) const
+    {
+        complex<T>* work = ptr_cast<complex<T>>(temp);
+        u8* fft_temp     = temp + align_up(sizeof(complex<T>) * fft.size, native_cache_alignment);
+
+        internal::cmul_range<false, false>(work, in, chirp_in.data(), size);
+        std::fill(work + size, work + fft.size, complex<T>(0));
+        fft.execute(work, work, fft_temp, cfalse);
+        internal::cmul_range<false, false>(work, work, filter.data(), fft.size);
+        fft.execute(work, work, fft_temp, ctrue);
+        internal::cmul_range<false, false>(out, work, chirp_out.data(), count);
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<complex<T>, Tag2>& in,
+                            univector<u8, Tag3>& temp) const
+    {
+        execute(out.data(), in.data(), temp.data());
+    }
+
+private:
+    dft_plan<T> fft;
+    univector<complex<T>> chirp_in;  // a^-n * w^(n^2 / 2)
+    univector<complex<T>> chirp_out; // w^(k^2 / 2)
+    univector<complex<T>> filter;    // spectrum of w^(-m^2 / 2), m = -(size - 1) .. count - 1
+
+    // w = exp(w_log + i * w_arg), a = exp(a_log + i * a_arg). Powers are evaluated in double
+    // precision from the logarithms, so the chirp phases don't accumulate rounding errors
+    czt_plan(size_t size, size_t count, double w_log, double w_arg, double a_log, double a_arg)
+        : size(size), count(count), temp_size(0), fft(next_poweroftwo(size + count - 1)), chirp_in(size),
+          chirp_out(count), filter(fft.size)
+    {
+        auto power = [&](double exponent, double a_power) {
+            const double magnitude = std::exp(w_log * exponent + a_log * a_power);
+            const double phase     = w_arg * exponent + a_arg * a_power;
+            return complex<T>(static_cast<T>(magnitude * std::cos(phase)),
+                              static_cast<T>(magnitude * std::sin(phase)));
+        };
+        for (size_t n = 0; n < size; n++)
+            chirp_in[n] = power(0.5 * n * n, -double(n));
+        for (size_t k = 0; k < count; k++)
+            chirp_out[k] = power(0.5 * k * k, 0);
+
+        filter = scalar(complex<T>(0));
+        for (size_t m = 0; m < count; m++)
+            filter[m] = power(-0.5 * m * m, 0);
+        for (size_t m = 1; m < size; m++)
+            filter[fft.size - m] = power(-0.5 * m * m, 0);
+
+        univector<u8> temp(fft.temp_size);
+        fft.execute(filter.data(), filter.data(), temp.data(), cfalse);
+        // the inverse transform is unnormalized
+        const T scale = T(1) / T(fft.size);
+        for (size_t i = 0; i < fft.size; i++)
+            filter[i] = complex<T>(filter[i].real() * scale, filter[i].imag() * scale);
+
+        temp_size = align_up(sizeof(complex<T>) * fft.size, native_cache_alignment) + fft.temp_size;
+    }
+};
+}
@@ -0,0 +1,464 @@
+/**
+ * Copyright (C) 2016 D Levin (http://www.kfrlib.com)
+ * This file is part of KFR
+ *
+ * KFR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFR is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KFR.
+ *
+ * If GPL is not suitable for your project, you must purchase a commercial license to use KFR.
+ * Buying a commercial license is mandatory as soon as you develop commercial activities without
+ * disclosing the source code of your own applications.
+ * See http://www.kfrlib.com for details.
+ */
+#pragma once
+
+#include "fft.hpp"
+
+namespace kfr
+{
+
+enum class dct_kind
+{
+    II,
+    III,
+    IV
+};
+
+namespace internal
+{
+
+template <bool reversed, typename T, size_t N>
+KFR_INTRIN vec<T, N> dct_load(const T* in, size_t size, size_t index)
+{
+    return reversed ? reverse(read<N>(in + size - index - N)) : read<N>(in + index);
+}
+
+template <bool reversed, typename T, size_t N>
+KFR_INTRIN void dct_store(T* out, size_t size, size_t index, vec<T, N> x)
+{
+    if (reversed)
+        write(out + size - index - N, reverse(x));
+    else
+        write(out + index, x);
+}
+
+// Cosine transforms of even size through a complex DFT of half the size. The sine transforms
+// only differ in the order and signs of either the input or the output, which are folded into
+// the same passes: DST-II(x)[k] = DCT-II((-1)^n x)[N-1-k], DST-III and DST-IV reverse their input
+// and negate the odd outputs of DCT-III and DCT-IV
+template <typename T>
+struct dct_impl
+{
+    size_t size;
+    size_t temp_size;
+
+    dct_impl(size_t size)
+        : size(size), temp_size(0), plan(size / 2), twiddle(size / 4 + 1), twiddle_dct(size / 4 + 1),
+          twiddle_pre(size / 2), twiddle_post(size / 2)
+    {
+        for (size_t k = 0; k < twiddle.size(); k++)
+        {
+            const cvec<T, 1> tw = calculate_twiddle<T>(k, size);
+            const cvec<T, 1> tc = calculate_twiddle<T>(k, size * 4);
+            twiddle[k]          = complex<T>(tw[0], tw[1]);
+            twiddle_dct[k]      = complex<T>(tc[0], tc[1]);
+        }
+        for (size_t k = 0; k < twiddle_pre.size(); k++)
+        {
+            const cvec<T, 1> pre  = calculate_twiddle<T>(4 * k + 1, size * 8);
+            const cvec<T, 1> post = calculate_twiddle<T>(k, size * 2);
+            twiddle_pre[k]        = complex<T>(pre[0], pre[1]);
+            twiddle_post[k]       = complex<T>(post[0], post[1]);
+        }
+        temp_size = align_up(sizeof(T) * size, native_cache_alignment) + plan.temp_size;
+    }
+
+    // v[m] = x[2m], v[N-1-m] = x[2m+1], then the DFT of v is split out of the half-size transform
+    // and rotated by exp(-i*pi*k/2N); k, N-k, N/2-k and N/2+k are produced from the same pair
+    template <bool sine>
+    void dct2(T* out, const T* in, u8* temp) const
+    {
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+        const size_t half      = size / 2;
+        T* v                   = ptr_cast<T>(temp);
+        complex<T>* z          = ptr_cast<complex<T>>(temp);
+
+        size_t m = 0;
+        KFR_LOOP_NOUNROLL
+        for (; m + width <= half; m += width)
+        {
+            const vec<T, width * 2> x = read<width * 2>(in + 2 * m);
+            write(v + m, even(x));
+            write(v + size - m - width, sine ? -reverse(odd(x)) : reverse(odd(x)));
+        }
+        KFR_LOOP_NOUNROLL
+        for (; m < half; m++)
+        {
+            v[m]            = in[2 * m];
+            v[size - 1 - m] = sine ? -in[2 * m + 1] : in[2 * m + 1];
+        }
+
+        plan.execute(z, z, temp + align_up(sizeof(T) * size, native_cache_alignment), cfalse);
+
+        const T dc = z[0].real();
+        const T ny = z[0].imag();
+        dct_store<sine>(out, size, 0, vec<T, 1>(dc + ny));
+        dct_store<sine>(out, size, half, vec<T, 1>((dc - ny) * c_sqrt_2<T, 1, 2>));
+
+        size_t k = 1;
+        KFR_LOOP_NOUNROLL
+        for (; 2 * (k + width) <= half + 1; k += width)
+            dct2_post<sine>(out, z, k, csize_t<width>());
+        KFR_LOOP_NOUNROLL
+        for (; 2 * k <= half; k++)
+            dct2_post<sine>(out, z, k, csize_t<1>());
+    }
+
+    template <bool sine>
+    void dct3(T* out, const T* in, u8* temp) const
+    {
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+        const size_t half      = size / 2;
+        T* v                   = ptr_cast<T>(temp);
+        complex<T>* z          = ptr_cast<complex<T>>(temp);
+
+        const T dc = dct_load<sine, T, 1>(in, size, 0)[0] * T(0.5);
+        const T ny = dct_load<sine, T, 1>(in, size, half)[0] * c_sqrt_2<T, 1, 2>;
+        z[0]       = complex<T>(dc + ny, dc - ny);
+
+        size_t k = 1;
+        KFR_LOOP_NOUNROLL
+        for (; 2 * (k + width) <= half + 1; k += width)
+            dct3_pre<sine>(z, in, k, csize_t<width>());
+        KFR_LOOP_NOUNROLL
+        for (; 2 * k <= half; k++)
+            dct3_pre<sine>(z, in, k, csize_t<1>());
+
+        plan.execute(z, z, temp + align_up(sizeof(T) * size, native_cache_alignment), ctrue);
+
+        size_t m = 0;
+        KFR_LOOP_NOUNROLL
+        for (; m + width <= half; m += width)
+        {
+            const vec<T, width> head = read<width>(v + m);
+            const vec<T, width> tail = reverse(read<width>(v + size - m - width));
+            write(out + 2 * m, interleave(head, sine ? -tail : tail));
+        }
+        KFR_LOOP_NOUNROLL
+        for (; m < half; m++)
+        {
+            const T head   = v[m];
+            const T tail   = v[size - 1 - m];
+            out[2 * m]     = head;
+            out[2 * m + 1] = sine ? -tail : tail;
+        }
+    }
+
+    // z[q] = (x[2q] + i x[N-1-2q]) * exp(-i*pi*(4q+1)/4N), Y = DFT(z) * exp(-i*pi*q/N),
+    // X[2q] = Re Y[q], X[N-1-2q] = -Im Y[q]
+    template <bool sine>
+    void dct4(T* out, const T* in, u8* temp) const
+    {
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+        const size_t half      = size / 2;
+        complex<T>* z          = ptr_cast<complex<T>>(temp);
+
+        size_t q = 0;
+        KFR_LOOP_NOUNROLL
+        for (; q + width <= half; q += width)
+        {
+            const vec<T, width> head = even(read<width * 2>(in + 2 * q));
+            const vec<T, width> tail = reverse(odd(read<width * 2>(in + size - 2 * q - width * 2)));
+            const cvec<T, width> x   = sine ? interleave(tail, head) : interleave(head, tail);
+            cwrite<width>(z + q, cmul(x, cread<width>(twiddle_pre.data() + q)));
+        }
+        KFR_LOOP_NOUNROLL
+        for (; q < half; q++)
+        {
+            const T head       = in[2 * q];
+            const T tail       = in[size - 1 - 2 * q];
+            const cvec<T, 1> x = sine ? make_vector(tail, head) : make_vector(head, tail);
+            cwrite<1>(z + q, cmul(x, cread<1>(twiddle_pre.data() + q)));
+        }
+
+        plan.execute(z, z, temp + align_up(sizeof(T) * size, native_cache_alignment), cfalse);
+
+        // the outputs of q and N/2-1-q are interleaved
+        q = 0;
+        KFR_LOOP_NOUNROLL
+        for (; 2 * (q + width) <= half; q += width)
+            dct4_post<sine>(out, z, q, csize_t<width>());
+        KFR_LOOP_NOUNROLL
+        for (; 2 * q < half; q++)
+            dct4_post<sine>(out, z, q, csize_t<1>());
+    }
+
+private:
+    dft_plan<T> plan;
+    univector<complex<T>> twiddle;
+    univector<complex<T>> twiddle_dct;
+    univector<complex<T>> twiddle_pre;
+    univector<complex<T>> twiddle_post;
+
+    template <bool sine, size_t width>
+    KFR_INTRIN void dct2_post(T* out, const complex<T>* z, size_t k, csize_t<width>) const
+    {
+        const size_t half         = size / 2;
+        const cvec<T, width> zk   = cread<width>(z + k);
+        const cvec<T, width> znk  = reverse<2>(negodd(cread<width>(z + half - k - width + 1)));
+        const cvec<T, width> fe   = (zk + znk) * T(0.5);
+        const cvec<T, width> fo   = (zk - znk) * T(0.5);
+        const cvec<T, width> t    = cmul(fo, cread<width>(twiddle.data() + k));
+        const cvec<T, width> twfo = negodd(swap<2>(t));
+        const cvec<T, width> tc   = cread<width>(twiddle_dct.data() + k);
+        const cvec<T, width> p    = cmul(fe + twfo, tc);
+        const cvec<T, width> r    = cmul(fe - twfo, tc);
+        dct_store<sine>(out, size, k, even(p));
+        dct_store<sine>(out, size, size - k - width + 1, reverse(-odd(p)));
+        dct_store<sine>(out, size, half - k - width + 1,
+                        reverse((even(r) - odd(r)) * c_sqrt_2<T, 1, 2>));
+        dct_store<sine>(out, size, half + k, (even(r) + odd(r)) * c_sqrt_2<T, 1, 2>);
+    }
+
+    template <bool sine, size_t width>
+    KFR_INTRIN void dct3_pre(complex<T>* z, const T* in, size_t k, csize_t<width>) const
+    {
+        const size_t half       = size / 2;
+        const vec<T, width> xk  = dct_load<sine, T, width>(in, size, k);
+        const vec<T, width> xnk = reverse(dct_load<sine, T, width>(in, size, size - k - width + 1));
+        const vec<T, width> xhk = reverse(dct_load<sine, T, width>(in, size, half - k - width + 1));
+        const vec<T, width> xhp = dct_load<sine, T, width>(in, size, half + k);
+        const cvec<T, width> tc = cread<width>(twiddle_dct.data() + k);
+
+        const cvec<T, width> vk = cmul_conj(interleave(xk, -xnk), tc) * T(0.5);
+        // conj(V[N/2-k]) = exp(-i*pi/4) * conj(c[k]) * (X[N/2-k] + i X[N/2+k]) / 2
+        const cvec<T, width> d0 = cmul_conj(interleave(xhk, xhp), tc);
+        const cvec<T, width> d  = (d0 + negodd(swap<2>(d0))) * (c_sqrt_2<T, 1, 2> * T(0.5));
+
+        const cvec<T, width> f1   = vk + d;
+        const cvec<T, width> f2   = vk - d;
+        const cvec<T, width> t    = cmul_conj(f2, cread<width>(twiddle.data() + k));
+        const cvec<T, width> twf2 = swap<2>(negodd(t));
+        cwrite<width>(z + k, f1 + twf2);
+        cwrite<width>(z + half - k - width + 1, reverse<2>(negodd(f1 - twf2)));
+    }
+
+    template <bool sine, size_t width>
+    KFR_INTRIN void dct4_post(T* out, const complex<T>* z, size_t q, csize_t<width>) const
+    {
+        const size_t half       = size / 2;
+        const size_t qr         = half - q - width;
+        const cvec<T, width> y  = cmul(cread<width>(z + q), cread<width>(twiddle_post.data() + q));
+        const cvec<T, width> yr = cmul(cread<width>(z + qr), cread<width>(twiddle_post.data() + qr));
+        const vec<T, width> im  = sine ? odd(y) : -odd(y);
+        const vec<T, width> imr = sine ? odd(yr) : -odd(yr);
+        write(out + 2 * q, interleave(even(y), reverse(imr)));
+        write(out + 2 * qr, interleave(even(yr), reverse(im)));
+    }
+};
+}
+
+/// Discrete cosine transforms of types II, III and IV for even sizes, computed through a complex
+/// DFT of size / 2. Transforms are unnormalized: DCT-III(DCT-II(x)) = DCT-IV(DCT-IV(x)) = x * size / 2.
+/// DCT-II: X[k] = sum x[n] cos(pi (2n+1) k / 2N),
+/// DCT-III: x[n] = X[0] / 2 + sum X[k] cos(pi (2n+1) k / 2N),
+/// DCT-IV: X[k] = sum x[n] cos(pi (2n+1) (2k+1) / 4N).
+/// In-place execution is supported, temp must hold temp_size bytes
+template <typename T>
+struct dct_plan
+{
+    size_t size;
+    size_t temp_size;
+
+    dct_plan(size_t size) : size(size), temp_size(0), impl(size) { temp_size = impl.temp_size; }
+
+    KFR_INTRIN void execute(T* out, const T* in, u8* temp, dct_kind kind = dct_kind::II) const
+    {
+        switch (kind)
+        {
+        case dct_kind::II:
+            impl.template dct2<false>(out, in, temp);
+            break;
+        case dct_kind::III:
+            impl.template dct3<false>(out, in, temp);
+            break;
+        case dct_kind::IV:
+            impl.template dct4<false>(out, in, temp);
+            break;
+        }
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<T, Tag1>& out, const univector<T, Tag2>& in, univector<u8, Tag3>& temp,
+                            dct_kind kind = dct_kind::II) const
+    {
+        execute(out.data(), in.data(), temp.data(), kind);
+    }
+
+private:
+    internal::dct_impl<T> impl;
+};
+
+/// Discrete sine transforms of types II, III and IV, normalized as dct_plan.
+/// DST-II: X[k] = sum x[n] sin(pi (2n+1) (k+1) / 2N),
+/// DST-III: x[n] = (-1)^n X[N-1] / 2 + sum X[k] sin(pi (2n+1) (k+1) / 2N), k < N-1,
+/// DST-IV: X[k] = sum x[n] sin(pi (2n+1) (2k+1) / 4N)
+template <typename T>
+struct dst_plan
+{
+    size_t size;
+    size_t temp_size;
+
+    dst_plan(size_t size) : size(size), temp_size(0), impl(size) { temp_size = impl.temp_size; }
+
+    KFR_INTRIN void execute(T* out, const T* in, u8* temp, dct_kind kind = dct_kind::II) const
+    {
+        switch (kind)
+        {
+        case dct_kind::II:
+            impl.template dct2<true>(out, in, temp);
+            break;
+        case dct_kind::III:
+            impl.template dct3<true>(out, in, temp);
+            break;
+        case dct_kind::IV:
+            impl.template dct4<true>(out, in, temp);
+            break;
+        }
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<T, Tag1>& out, const univector<T, Tag2>& in, univector<u8, Tag3>& temp,
+                            dct_kind kind = dct_kind::II) const
+    {
+        execute(out.data(), in.data(), temp.data(), kind);
+    }
+
+private:
+    internal::dct_impl<T> impl;
+};
+
+/// Modified DCT of 2 * size windowed samples into size coefficients, computed as a DCT-IV of the
+/// folded frame. size must be even. The inverse transform is unnormalized and windowed again, so
+/// overlap-adding consecutive inverse frames hopped by size samples and scaling by 2 / size
+/// reconstructs the signal when window[n]^2 + window[n + size]^2 = 1 (see mdct_stream)
+template <typename T>
+struct mdct_plan
+{
+    size_t size;
+    size_t temp_size;
+    univector<T> window;
+
+    /// Uses the sine window
+    mdct_plan(size_t size) : size(size), temp_size(0), window(size * 2), dct(size)
+    {
+        for (size_t n = 0; n < window.size(); n++)
+            window[n] = static_cast<T>(native::sin(c_pi<double> * (n + 0.5) / window.size()));
+        temp_size = align_up(sizeof(T) * size, native_cache_alignment) + dct.temp_size;
+    }
+    template <size_t Tag>
+    mdct_plan(size_t size, const univector<T, Tag>& window)
+        : size(size), temp_size(0), window(window), dct(size)
+    {
+        temp_size = align_up(sizeof(T) * size, native_cache_alignment) + dct.temp_size;
+    }
+
+    /// Direct: size coefficients from 2 * size samples, inverse: 2 * size samples from size coefficients
+    KFR_INTRIN void execute(T* out, const T* in, u8* temp, bool inverse = false) const
+    {
+        T* folded      = ptr_cast<T>(temp);
+        u8* dct_temp   = temp + align_up(sizeof(T) * size, native_cache_alignment);
+        const size_t h = size / 2;
+        const T* w     = window.data();
+        if (inverse)
+        {
+            dct.execute(folded, in, dct_temp, dct_kind::IV);
+            // (u1, u2) -> (u2, -u2', -u1', -u1), where ' is reversal
+            KFR_LOOP_NOUNROLL
+            for (size_t j = 0; j < h; j++)
+            {
+                out[j]            = folded[h + j] * w[j];
+                out[h + j]        = -folded[size - 1 - j] * w[h + j];
+                out[size + j]     = -folded[h - 1 - j] * w[size + j];
+                out[size + h + j] = -folded[j] * w[size + h + j];
+            }
+        }
+        else
+        {
+            // (a, b, c, d) -> (-c' - d, a - b'), where ' is reversal
+            KFR_LOOP_NOUNROLL
+            for (size_t j = 0; j < h; j++)
+            {
+                folded[j] =
+                    -in[size + h - 1 - j] * w[size + h - 1 - j] - in[size + h + j] * w[size + h + j];
+                folded[h + j] = in[j] * w[j] - in[size - 1 - j] * w[size - 1 - j];
+            }
+            dct.execute(out, folded, dct_temp, dct_kind::IV);
+        }
+    }
+
+private:
+    dct_plan<T> dct;
+};
+
+/// MDCT analysis and synthesis of a continuous signal with 50% overlapped frames.
+/// analyze() takes size new samples and returns the coefficients of the frame ending with them,
+/// synthesize() takes the coefficients of one frame and returns size samples with time-domain
+/// aliasing cancelled by the previous frame. The output is delayed by size samples
+template <typename T>
+struct mdct_stream
+{
+    mdct_stream(size_t size) : plan(size) { reset(); }
+    template <size_t Tag>
+    mdct_stream(size_t size, const univector<T, Tag>& window) : plan(size, window)
+    {
+        reset();
+    }
+
+    size_t size() const { return plan.size; }
+
+    void analyze(T* coefficients, const T* input)
+    {
+        const size_t n = plan.size;
+        builtin_memcpy(input_frame.data(), input_frame.data() + n, sizeof(T) * n);
+        builtin_memcpy(input_frame.data() + n, input, sizeof(T) * n);
+        plan.execute(coefficients, input_frame.data(), temp.data());
+    }
+
+    void synthesize(T* output, const T* coefficients)
+    {
+        const size_t n = plan.size;
+        const T scale  = T(2) / n;
+        plan.execute(output_frame.data(), coefficients, temp.data(), true);
+        KFR_LOOP_NOUNROLL
+        for (size_t i = 0; i < n; i++)
+        {
+            output[i]  = (overlap[i] + output_frame[i]) * scale;
+            overlap[i] = output_frame[n + i];
+        }
+    }
+
+    void reset()
+    {
+        input_frame  = univector<T>(plan.size * 2, 0);
+        output_frame = univector<T>(plan.size * 2, 0);
+        overlap      = univector<T>(plan.size, 0);
+        temp         = univector<u8>(plan.temp_size);
+    }
+
+private:
+    mdct_plan<T> plan;
+    univector<T> input_frame;
+    univector<T> output_frame;
+    univector<T> overlap;
+    univector<u8> temp;
+};
+}
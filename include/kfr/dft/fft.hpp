@@ -27,7 +27,16 @@
 #include "../base/memory.hpp"
 #include "../base/read_write.hpp"
 #include "../base/vec.hpp"
+#include "../dispatch/cpuid_auto.hpp"
 #include "../misc/small_buffer.hpp"
+#include "../misc/thread_pool.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
 
 #include "../cometa/string.hpp"
 
@@ -42,6 +51,48 @@
 namespace kfr
 {
 
+template <typename T>
+struct dft_plan;
+
+namespace internal
+{
+template <typename T>
+struct dft_fourstep;
+template <typename T>
+struct dft_batch;
+template <typename T>
+struct dft_unordered;
+
+template <typename T>
+KFR_INTRIN void interleave_split(complex<T>* out, const T* re, const T* im, size_t size)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    size_t i               = 0;
+    for (; i < size / width * width; i += width)
+        cwrite<width>(out + i, interleave(read<width>(re + i), read<width>(im + i)));
+    for (; i < size; i++)
+        out[i] = complex<T>(re[i], im[i]);
+}
+template <typename T>
+KFR_INTRIN void deinterleave_split(T* re, T* im, const complex<T>* in, size_t size)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    size_t i               = 0;
+    for (; i < size / width * width; i += width)
+    {
+        vec<T, width> r, m;
+        split(splitpairs(cread<width>(in + i)), r, m);
+        write(re + i, r);
+        write(im + i, m);
+    }
+    for (; i < size; i++)
+    {
+        re[i] = in[i].real();
+        im[i] = in[i].imag();
+    }
+}
+}
+
 template <typename T>
 struct dft_stage
 {
@@ -52,16 +103,24 @@ struct dft_stage
     size_t repeats    = 1;
     size_t out_offset = 0;
     const char* name;
-    bool recursion = false;
+    bool recursion   = false;
+    bool split_input = false;
 
     void initialize(size_t size) { do_initialize(size); }
 
     KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp) { do_execute(out, in, temp); }
+    KFR_INTRIN void execute_split(complex<T>* out, const T* re, const T* im, u8* temp)
+    {
+        do_execute_split(out, re, im, temp);
+    }
     virtual ~dft_stage() {}
 
 protected:
     virtual void do_initialize(size_t) {}
     virtual void do_execute(complex<T>*, const complex<T>*, u8* temp) = 0;
+
+    // First stage of a transform with split-complex input, called only if split_input is set
+    virtual void do_execute_split(complex<T>*, const T*, const T*, u8*) {}
 };
 
 #pragma clang diagnostic push
@@ -149,22 +208,14 @@ KFR_INTRIN cvec<T, width> radix4_apply_twiddle(csize_t<width>, ctrue_t /*split_f
     return w;
 }
 
-template <size_t width, bool splitout, bool splitin, bool use_br2, bool inverse, bool aligned, typename T>
-KFR_INTRIN void radix4_body(size_t N, csize_t<width>, ctrue_t, cbool_t<splitout>, cbool_t<splitin>,
-                            cbool_t<use_br2>, cbool_t<inverse>, cbool_t<aligned>, complex<T>* out,
-                            const complex<T>* in, const complex<T>* twiddle)
+template <size_t width, bool write_split, bool use_br2, bool inverse, bool aligned, typename T>
+KFR_INTRIN void radix4_body_split(size_t N4, csize_t<width>, cbool_t<write_split>, cbool_t<use_br2>,
+                                  cbool_t<inverse>, cbool_t<aligned>, complex<T>* out, vec<T, width> re0,
+                                  vec<T, width> im0, vec<T, width> re1, vec<T, width> im1, vec<T, width> re2,
+                                  vec<T, width> im2, vec<T, width> re3, vec<T, width> im3,
+                                  const complex<T>* twiddle)
 {
-    const size_t N4 = N / 4;
     cvec<T, width> w1, w2, w3;
-    constexpr bool read_split  = !splitin && splitout;
-    constexpr bool write_split = splitin && !splitout;
-
-    vec<T, width> re0, im0, re1, im1, re2, im2, re3, im3;
-
-    split(cread_split<width, aligned, read_split>(in + N4 * 0), re0, im0);
-    split(cread_split<width, aligned, read_split>(in + N4 * 1), re1, im1);
-    split(cread_split<width, aligned, read_split>(in + N4 * 2), re2, im2);
-    split(cread_split<width, aligned, read_split>(in + N4 * 3), re3, im3);
 
     const vec<T, width> sum02re = re0 + re2;
     const vec<T, width> sum02im = im0 + im2;
@@ -193,6 +244,51 @@ KFR_INTRIN void radix4_body(size_t N, csize_t<width>, ctrue_t, cbool_t<splitout>
                                                                    cread<width, true>(twiddle + width * 2)));
 }
 
+template <size_t width, bool splitout, bool splitin, bool use_br2, bool inverse, bool aligned, typename T>
+KFR_INTRIN void radix4_body(size_t N, csize_t<width>, ctrue_t, cbool_t<splitout>, cbool_t<splitin>,
+                            cbool_t<use_br2>, cbool_t<inverse>, cbool_t<aligned>, complex<T>* out,
+                            const complex<T>* in, const complex<T>* twiddle)
+{
+    const size_t N4 = N / 4;
+    constexpr bool read_split  = !splitin && splitout;
+    constexpr bool write_split = splitin && !splitout;
+
+    vec<T, width> re0, im0, re1, im1, re2, im2, re3, im3;
+
+    split(cread_split<width, aligned, read_split>(in + N4 * 0), re0, im0);
+    split(cread_split<width, aligned, read_split>(in + N4 * 1), re1, im1);
+    split(cread_split<width, aligned, read_split>(in + N4 * 2), re2, im2);
+    split(cread_split<width, aligned, read_split>(in + N4 * 3), re3, im3);
+
+    radix4_body_split(N4, csize<width>, cbool<write_split>, cbool<use_br2>, cbool<inverse>, cbool<aligned>, out,
+                      re0, im0, re1, im1, re2, im2, re3, im3, twiddle);
+}
+
+// First radix-4 pass reading split-complex (separate real and imaginary arrays) input,
+// which is the layout the split format passes use internally
+template <size_t width, bool use_br2, bool prefetch, bool inverse, typename T>
+KFR_INTRIN void radix4_pass_split_input(size_t N, csize_t<width>, cbool_t<use_br2>, cbool_t<prefetch>,
+                                        cbool_t<inverse>, complex<T>* out, const T* re, const T* im,
+                                        const complex<T>* twiddle)
+{
+    constexpr static size_t prefetch_offset = width * 8;
+    const size_t N4                         = N / 4;
+#pragma clang loop unroll_count(default_unroll_count)
+    for (size_t n2 = 0; n2 < N4; n2 += width)
+    {
+        if (prefetch)
+        {
+            __builtin_prefetch(ptr_cast<void>(re + n2 + prefetch_offset), 0, _MM_HINT_T0);
+            __builtin_prefetch(ptr_cast<void>(im + n2 + prefetch_offset), 0, _MM_HINT_T0);
+        }
+        radix4_body_split(N4, csize<width>, cfalse, cbool<use_br2>, cbool<inverse>, cfalse, out + n2,
+                          read<width>(re + n2), read<width>(im + n2), read<width>(re + n2 + N4),
+                          read<width>(im + n2 + N4), read<width>(re + n2 + N4 * 2),
+                          read<width>(im + n2 + N4 * 2), read<width>(re + n2 + N4 * 3),
+                          read<width>(im + n2 + N4 * 3), twiddle + n2 * 3);
+    }
+}
+
 template <typename T>
 KFR_NOINLINE cvec<T, 1> calculate_twiddle(size_t n, size_t size)
 {
@@ -200,15 +296,15 @@ KFR_NOINLINE cvec<T, 1> calculate_twiddle(size_t n, size_t size)
     {
         return make_vector(static_cast<T>(1), static_cast<T>(0));
     }
-    else if (n == size / 4)
+    else if (n * 4 == size)
     {
         return make_vector(static_cast<T>(0), static_cast<T>(-1));
     }
-    else if (n == size / 2)
+    else if (n * 2 == size)
     {
         return make_vector(static_cast<T>(-1), static_cast<T>(0));
     }
-    else if (n == size * 3 / 4)
+    else if (n * 4 == size * 3)
     {
         return make_vector(static_cast<T>(0), static_cast<T>(1));
     }
@@ -414,29 +510,65 @@ KFR_SINTRIN ctrue_t radix4_pass(csize_t<4>, size_t blocks, csize_t<width>, cfals
     return {};
 }
 
-template <typename T, bool splitin, bool is_even, bool inverse>
-struct fft_stage_impl : dft_stage<T>
+// Instruction sets the radix-4 stages are built for in addition to the compile-time target.
+// Only targets at least as new as the compile-time one are included, so a binary built for the
+// newest target carries a single set of kernels
+constexpr auto dft_cpu_list = cvals<cpu_t, cpu_t::avx2, cpu_t::avx1, cpu_t::sse41, cpu_t::sse2>;
+constexpr auto dft_cpus     = cfilter(dft_cpu_list, dft_cpu_list >= cpuval<cpu_t::native>);
+
+// Newest instruction set of dft_cpus supported by the host, the compile-time target otherwise
+inline cpu_t dft_select_cpu()
 {
-    fft_stage_impl(size_t stage_size)
+    const cpu_t host = get_cpu();
+    cpu_t selected   = cpu_t::native;
+    bool found       = false;
+    cforeach(dft_cpus, [&](auto cpu) {
+        if (!found && val_of(cpu) <= host)
+        {
+            selected = val_of(cpu);
+            found    = true;
+        }
+    });
+    return selected;
+}
+
+template <typename Stage>
+struct dft_stage_body
+{
+    Stage* stage;
+    template <typename... Args>
+    KFR_INTRIN void operator()(Args... args) const
     {
-        this->stage_size = stage_size;
-        this->repeats    = 4;
-        this->recursion  = true;
-        this->data_size  = align_up(sizeof(complex<T>) * stage_size / 4 * 3, native_cache_alignment);
+        stage->execute_body(args...);
     }
+};
 
-protected:
-    constexpr static bool prefetch = true;
-    constexpr static bool aligned  = false;
-    constexpr static size_t width  = vector_width<T, cpu_t::native>;
+// Runs the stage body compiled for the given instruction set through the trampolines of the
+// runtime dispatcher; the body and everything it inlines are generated for that target
+template <cpu_t cpu, typename Stage, typename... Args>
+KFR_INTRIN void dft_execute_for_cpu(ccpu_t<cpu>, Stage* stage, Args... args)
+{
+    cpu_caller<cpu>::call(dft_stage_body<Stage>{ stage }, args...);
+}
+template <typename Stage, typename... Args>
+KFR_INTRIN void dft_execute_for_cpu(ccpu_t<cpu_t::native>, Stage* stage, Args... args)
+{
+    stage->execute_body(args...);
+}
 
-    virtual void do_initialize(size_t size) override final
+template <typename T, bool splitin, bool is_even, bool prefetch, bool inverse, cpu_t cpu = cpu_t::native>
+struct fft_stage_impl : dft_stage<T>
+{
+    fft_stage_impl(size_t stage_size)
     {
-        complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
-        initialize_twiddles<T, width>(twiddle, this->stage_size, size, true);
+        this->stage_size  = stage_size;
+        this->repeats     = 4;
+        this->recursion   = true;
+        this->split_input = !splitin;
+        this->data_size   = align_up(sizeof(complex<T>) * stage_size / 4 * 3, native_cache_alignment);
     }
 
-    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* /*temp*/) override final
+    KFR_INTRIN void execute_body(complex<T>* out, const complex<T>* in)
     {
         const complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
         if (splitin)
@@ -447,9 +579,35 @@ protected:
         radix4_pass(stage_size, 1, csize<width>, ctrue, cbool<splitin>, cbool<!is_even>, cbool<prefetch>,
                     cbool<inverse>, cbool<aligned>, out, in, twiddle);
     }
+    KFR_INTRIN void execute_body(complex<T>* out, const T* re, const T* im)
+    {
+        const complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        radix4_pass_split_input(this->stage_size, csize<width>, cbool<!is_even>, cbool<prefetch>,
+                                cbool<inverse>, out, re, im, twiddle);
+    }
+
+protected:
+    constexpr static bool aligned = false;
+    constexpr static size_t width = vector_width<T, cpu>;
+
+    virtual void do_initialize(size_t size) override final
+    {
+        complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        initialize_twiddles<T, width>(twiddle, this->stage_size, size, true);
+    }
+
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* /*temp*/) override final
+    {
+        dft_execute_for_cpu(ccpu<cpu>, this, out, in);
+    }
+
+    virtual void do_execute_split(complex<T>* out, const T* re, const T* im, u8*) override final
+    {
+        dft_execute_for_cpu(ccpu<cpu>, this, out, re, im);
+    }
 };
 
-template <typename T, bool splitin, size_t size, bool inverse>
+template <typename T, bool splitin, size_t size, bool inverse, cpu_t cpu = cpu_t::native>
 struct fft_final_stage_impl : dft_stage<T>
 {
     fft_final_stage_impl(size_t)
@@ -462,7 +620,7 @@ struct fft_final_stage_impl : dft_stage<T>
     }
 
 protected:
-    constexpr static size_t width  = vector_width<T, cpu_t::native>;
+    constexpr static size_t width  = vector_width<T, cpu>;
     constexpr static bool is_even  = cometa::is_even(ilog2(size));
     constexpr static bool use_br2  = !is_even;
     constexpr static bool aligned  = false;
@@ -480,14 +638,24 @@ protected:
     }
 
     virtual void do_execute(complex<T>* out, const complex<T>* in, u8* /*temp*/) override final
+    {
+        dft_execute_for_cpu(ccpu<cpu>, this, out, in);
+    }
+
+public:
+    KFR_INTRIN void execute_body(complex<T>* out, const complex<T>* in)
+    {
+        execute_passes(out, in, ptr_cast<complex<T>>(this->data));
+    }
+    KFR_INTRIN static void execute_passes(complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
     {
         constexpr bool is_double    = sizeof(T) == 8;
         constexpr size_t final_size = is_even ? (is_double ? 4 : 16) : (is_double ? 8 : 32);
-        const complex<T>* twiddle   = ptr_cast<complex<T>>(this->data);
         final_pass(csize<final_size>, out, in, twiddle);
     }
 
-    KFR_INTRIN void final_pass(csize_t<8>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
+private:
+    KFR_INTRIN static void final_pass(csize_t<8>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
     {
         radix4_pass(csize<512>, 1, csize<width>, ctrue, cbool<splitin>, cbool<use_br2>, cbool<prefetch>,
                     cbool<inverse>, cbool<aligned>, out, in, twiddle);
@@ -499,7 +667,7 @@ protected:
                     cbool<inverse>, cbool<aligned>, out, out, twiddle);
     }
 
-    KFR_INTRIN void final_pass(csize_t<32>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
+    KFR_INTRIN static void final_pass(csize_t<32>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
     {
         radix4_pass(csize<512>, 1, csize<width>, ctrue, cbool<splitin>, cbool<use_br2>, cbool<prefetch>,
                     cbool<inverse>, cbool<aligned>, out, in, twiddle);
@@ -509,7 +677,7 @@ protected:
                     cbool<inverse>, cbool<aligned>, out, out, twiddle);
     }
 
-    KFR_INTRIN void final_pass(csize_t<4>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
+    KFR_INTRIN static void final_pass(csize_t<4>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
     {
         radix4_pass(csize<1024>, 1, csize<width>, ctrue, cbool<splitin>, cbool<use_br2>, cbool<prefetch>,
                     cbool<inverse>, cbool<aligned>, out, in, twiddle);
@@ -523,7 +691,7 @@ protected:
                     cbool<inverse>, cbool<aligned>, out, out, twiddle);
     }
 
-    KFR_INTRIN void final_pass(csize_t<16>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
+    KFR_INTRIN static void final_pass(csize_t<16>, complex<T>* out, const complex<T>* in, const complex<T>* twiddle)
     {
         radix4_pass(csize<1024>, 1, csize<width>, ctrue, cbool<splitin>, cbool<use_br2>, cbool<prefetch>,
                     cbool<inverse>, cbool<aligned>, out, in, twiddle);
@@ -536,7 +704,86 @@ protected:
     }
 };
 
-template <typename T, bool is_even>
+// The whole chain of radix-4 stages of a power of two size generated at compile time as one stage:
+// passes are inlined into each other with no virtual calls or runtime recursion between them
+template <typename T, size_t log2n, bool prefetch, bool inverse, cpu_t cpu = cpu_t::native>
+struct fft_fused_stage_impl : dft_stage<T>
+{
+    fft_fused_stage_impl(size_t)
+    {
+        this->stage_size  = size;
+        this->split_input = size > final_size;
+        size_t count      = final_size * 3 / 2;
+        for (size_t stage_size = size; stage_size > final_size; stage_size /= 4)
+            count += stage_size / 4 * 3;
+        this->data_size = align_up(sizeof(complex<T>) * count, native_cache_alignment);
+    }
+
+    KFR_INTRIN void execute_body(complex<T>* out, const complex<T>* in)
+    {
+        const complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        fused_pass(csize<size>, cfalse, cbool<size == final_size>, out, in, twiddle);
+    }
+    KFR_INTRIN void execute_body(complex<T>* out, const T* re, const T* im)
+    {
+        const complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        radix4_pass_split_input(size, csize<width>, cbool<!is_even>, cbool<prefetch>, cbool<inverse>, out, re,
+                                im, twiddle);
+        twiddle += size / 4 * 3;
+        quarters(csize<size / 4>, out, twiddle);
+    }
+
+protected:
+    constexpr static size_t size       = size_t(1) << log2n;
+    constexpr static bool is_even      = cometa::is_even(log2n);
+    constexpr static size_t final_size = is_even ? 1024 : 512;
+    constexpr static size_t width      = vector_width<T, cpu>;
+    constexpr static bool aligned      = false;
+
+    virtual void do_initialize(size_t total_size) override final
+    {
+        complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        for (size_t stage_size = size; stage_size > final_size; stage_size /= 4)
+            initialize_twiddles<T, width>(twiddle, stage_size, total_size, true);
+        for (size_t stage_size = final_size; stage_size > 4; stage_size /= 4)
+            initialize_twiddles<T, width>(twiddle, stage_size, total_size, true);
+    }
+
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* /*temp*/) override final
+    {
+        dft_execute_for_cpu(ccpu<cpu>, this, out, in);
+    }
+
+    virtual void do_execute_split(complex<T>* out, const T* re, const T* im, u8*) override final
+    {
+        dft_execute_for_cpu(ccpu<cpu>, this, out, re, im);
+    }
+
+    template <size_t N, bool splitin>
+    KFR_INTRIN static void fused_pass(csize_t<N>, cbool_t<splitin>, ctrue_t /*final*/, complex<T>* out,
+                                      const complex<T>* in, const complex<T>* twiddle)
+    {
+        fft_final_stage_impl<T, splitin, N, inverse, cpu>::execute_passes(out, in, twiddle);
+    }
+
+    template <size_t N, bool splitin>
+    KFR_INTRIN static void fused_pass(csize_t<N>, cbool_t<splitin>, cfalse_t /*final*/, complex<T>* out,
+                                      const complex<T>* in, const complex<T>* twiddle)
+    {
+        radix4_pass(csize<N>, 1, csize<width>, ctrue, cbool<splitin>, cbool<!is_even>, cbool<prefetch>,
+                    cbool<inverse>, cbool<aligned>, out, splitin ? out : in, twiddle);
+        quarters(csize<N / 4>, out, twiddle);
+    }
+
+    template <size_t N4>
+    KFR_INTRIN static void quarters(csize_t<N4>, complex<T>* out, const complex<T>* twiddle)
+    {
+        for (size_t i = 0; i < 4; i++)
+            fused_pass(csize<N4>, ctrue, cbool<N4 == final_size>, out + N4 * i, out + N4 * i, twiddle);
+    }
+};
+
+template <typename T, bool is_even, cpu_t cpu = cpu_t::native>
 struct fft_reorder_stage_impl : dft_stage<T>
 {
     fft_reorder_stage_impl(size_t stage_size)
@@ -551,10 +798,15 @@ protected:
 
     virtual void do_initialize(size_t) override final {}
 
-    virtual void do_execute(complex<T>* out, const complex<T>*, u8* /*temp*/) override final
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* /*temp*/) override final
     {
-        fft_reorder(out, log2n, cbool<!is_even>);
+        if (in != out)
+            builtin_memcpy(out, in, sizeof(complex<T>) * this->stage_size);
+        dft_execute_for_cpu(ccpu<cpu>, this, out);
     }
+
+public:
+    KFR_INTRIN void execute_body(complex<T>* out) { fft_reorder(out, log2n, cbool<!is_even>); }
 };
 
 template <typename T, size_t log2n, bool inverse>
@@ -775,87 +1027,660 @@ protected:
     }
 };
 
-template <typename T, bool splitin, bool is_even>
-struct fft_stage_impl_t
+template <typename T>
+KFR_NOINLINE void initialize_twiddles_mixed(complex<T>*& twiddle, size_t width, size_t radix,
+                                            size_t iterations, size_t size)
 {
-    template <bool inverse>
-    using type = internal::fft_stage_impl<T, splitin, is_even, inverse>;
-};
-template <typename T, bool splitin, size_t size>
-struct fft_final_stage_impl_t
+    size_t i = 0;
+    KFR_LOOP_NOUNROLL
+    for (; width > 0; width /= 2)
+    {
+        KFR_LOOP_NOUNROLL
+        for (; i < iterations / width * width; i += width)
+        {
+            KFR_LOOP_NOUNROLL
+            for (size_t j = 1; j < radix; j++)
+            {
+                KFR_LOOP_NOUNROLL
+                for (size_t k = 0; k < width; k++)
+                {
+                    const cvec<T, 1> tw = calculate_twiddle<T>((i + k) * j, size);
+                    twiddle[k]          = complex<T>(tw[0], tw[1]);
+                }
+                twiddle += width;
+            }
+        }
+    }
+}
+
+template <typename T, size_t radix>
+constexpr size_t dft_radix_width =
+    std::max(size_t(1), radix >= 7 ? vector_width<T, cpu_t::native> / 2
+                                   : radix >= 4 ? vector_width<T, cpu_t::native>
+                                                : vector_width<T, cpu_t::native> * 2);
+
+template <typename T, size_t radix, bool inverse>
+struct dft_stage_fixed_impl : dft_stage<T>
 {
-    template <bool inverse>
-    using type = internal::fft_final_stage_impl<T, splitin, size, inverse>;
+    dft_stage_fixed_impl(size_t iterations, size_t blocks) : iterations(iterations), blocks(blocks)
+    {
+        this->stage_size = radix * iterations;
+        this->data_size  = align_up(sizeof(complex<T>) * iterations * (radix - 1), native_cache_alignment);
+    }
+
+protected:
+    constexpr static size_t width = dft_radix_width<T, radix>;
+    size_t iterations;
+    size_t blocks;
+
+    virtual void do_initialize(size_t) override final
+    {
+        complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        initialize_twiddles_mixed<T>(twiddle, width, radix, iterations, this->stage_size);
+    }
+
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* /*temp*/) override final
+    {
+        const complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        const size_t stage_size   = this->stage_size;
+        KFR_LOOP_NOUNROLL
+        for (size_t b = 0; b < blocks; b++)
+        {
+            butterflies(iterations, csize<width>, csize<radix>, cbool<inverse>, out, in, twiddle, iterations);
+            in += stage_size;
+            out += stage_size;
+        }
+    }
 };
-template <typename T, bool is_even>
-struct fft_reorder_stage_impl_t
+
+template <typename T, size_t radix, bool inverse>
+struct dft_stage_fixed_final_impl : dft_stage<T>
 {
-    template <bool>
-    using type = internal::fft_reorder_stage_impl<T, is_even>;
+    dft_stage_fixed_final_impl(size_t blocks) : blocks(blocks)
+    {
+        this->stage_size = radix;
+        this->temp_size  = align_up(sizeof(complex<T>) * radix * (blocks + 1), native_cache_alignment);
+    }
+
+protected:
+    constexpr static size_t width = dft_radix_width<T, radix>;
+    size_t blocks;
+
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* temp) override final
+    {
+        // Output is scattered over the whole buffer and transposed reads may touch
+        // one element past the block, so always read from a padded copy
+        complex<T>* scratch = ptr_cast<complex<T>>(temp);
+        builtin_memcpy(scratch, in, sizeof(complex<T>) * radix * blocks);
+        const complex<T>* src = scratch;
+        butterflies(blocks, csize<width>, csize<radix>, cbool<inverse>, out, src, blocks);
+    }
 };
-template <typename T, size_t log2n, bool aligned>
-struct fft_specialization_t
+
+template <bool inverse, typename T>
+KFR_INTRIN void generic_dft_cycle(csize_t<0>, cbool_t<inverse>, size_t&, size_t, size_t, complex<T>*,
+                                  const complex<T>*, const complex<T>*, const complex<T>*, complex<T>*)
 {
-    template <bool inverse>
-    using type = internal::fft_specialization<T, log2n, inverse>;
-};
 }
 
-namespace dft_type
+template <size_t width, bool inverse, typename T>
+KFR_INTRIN void generic_dft_cycle(csize_t<width>, cbool_t<inverse>, size_t& i, size_t iterations, size_t radix,
+                                  complex<T>* out, const complex<T>* in, const complex<T>* roots,
+                                  const complex<T>* twiddle, complex<T>* scratch)
 {
-constexpr cbools_t<true, true> both{};
-constexpr cbools_t<true, false> direct{};
-constexpr cbools_t<false, true> inverse{};
+    KFR_LOOP_NOUNROLL
+    for (; i < iterations / width * width; i += width)
+    {
+        KFR_LOOP_NOUNROLL
+        for (size_t m = 0; m < radix; m++)
+            cwrite<width>(scratch + m * width, cread<width>(in + i + iterations * m));
+
+        cvec<T, width> sum = cread<width>(scratch);
+        KFR_LOOP_NOUNROLL
+        for (size_t m = 1; m < radix; m++)
+            sum = sum + cread<width>(scratch + m * width);
+        cwrite<width>(out + i, sum);
+
+        const complex<T>* tw = twiddle + i * (radix - 1);
+        KFR_LOOP_NOUNROLL
+        for (size_t k = 1; k < radix; k++)
+        {
+            sum       = cread<width>(scratch);
+            size_t mk = 0;
+            KFR_LOOP_NOUNROLL
+            for (size_t m = 1; m < radix; m++)
+            {
+                mk += k;
+                mk = mk >= radix ? mk - radix : mk;
+                const cvec<T, width> x = cread<width>(scratch + m * width);
+                const cvec<T, 1> root  = cread<1>(roots + mk);
+                sum = sum + (inverse ? cmul_conj(x, root) : cmul(x, root));
+            }
+            const cvec<T, width> w = cread<width>(tw + width * (k - 1));
+            cwrite<width>(out + i + iterations * k, inverse ? cmul_conj(sum, w) : cmul(sum, w));
+        }
+    }
+    generic_dft_cycle(csize<width / 2>, cbool<inverse>, i, iterations, radix, out, in, roots, twiddle,
+                      scratch);
 }
 
-template <typename T>
-struct dft_plan
+template <typename T, bool inverse>
+struct dft_stage_generic_impl : dft_stage<T>
 {
-    using dft_stage_ptr = std::unique_ptr<dft_stage<T>>;
+    dft_stage_generic_impl(size_t radix, size_t iterations, size_t blocks)
+        : radix(radix), iterations(iterations), blocks(blocks)
+    {
+        this->stage_size = radix * iterations;
+        this->data_size =
+            align_up(sizeof(complex<T>) * (iterations * (radix - 1) + radix), native_cache_alignment);
+        this->temp_size = align_up(sizeof(complex<T>) * radix * width, native_cache_alignment);
+    }
 
-    size_t size;
-    size_t temp_size;
+protected:
+    constexpr static size_t width = vector_width<T, cpu_t::native>;
+    size_t radix;
+    size_t iterations;
+    size_t blocks;
 
-    template <bool direct = true, bool inverse = true>
-    dft_plan(size_t size, cbools_t<direct, inverse> type = dft_type::both)
-        : size(size), temp_size(0), data_size(0)
+    virtual void do_initialize(size_t) override final
     {
-        if (is_poweroftwo(size))
+        complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        initialize_twiddles_mixed<T>(twiddle, width, radix, iterations, this->stage_size);
+        KFR_LOOP_NOUNROLL
+        for (size_t m = 0; m < radix; m++)
         {
-            const size_t log2n = ilog2(size);
-            cswitch(csizes<1, 2, 3, 4, 5, 6, 7, 8>, log2n,
-                    [&](auto log2n) {
-                        add_stage<internal::fft_specialization_t<T, val_of(log2n), false>::template type>(
-                            size, type);
-                    },
-                    [&]() {
-                        cswitch(cfalse_true, is_even(log2n), [&](auto is_even) {
-                            make_fft(size, type, is_even, ctrue);
-                            add_stage<internal::fft_reorder_stage_impl_t<T, val_of(is_even)>::template type>(
-                                size, type);
-                        });
-                    });
-            initialize(type);
+            const cvec<T, 1> root = calculate_twiddle<T>(m, radix);
+            twiddle[m]            = complex<T>(root[0], root[1]);
         }
     }
-    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, bool inverse = false) const
+
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* temp) override final
     {
-        if (inverse)
-            execute_dft(ctrue, out, in, temp);
-        else
-            execute_dft(cfalse, out, in, temp);
+        const complex<T>* twiddle = ptr_cast<complex<T>>(this->data);
+        const complex<T>* roots   = twiddle + iterations * (radix - 1);
+        const size_t stage_size   = this->stage_size;
+        complex<T>* scratch       = ptr_cast<complex<T>>(temp);
+        KFR_LOOP_NOUNROLL
+        for (size_t b = 0; b < blocks; b++)
+        {
+            size_t i = 0;
+            generic_dft_cycle(csize<width>, cbool<inverse>, i, iterations, radix, out, in, roots, twiddle,
+                              scratch);
+            in += stage_size;
+            out += stage_size;
+        }
     }
-    template <bool inverse>
-    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, cbool_t<inverse> inv) const
+};
+
+template <typename T>
+struct dft_reorder_stage_impl : dft_stage<T>
+{
+    dft_reorder_stage_impl(const std::vector<size_t>& radices, bool transposed)
+        : radices(radices), transposed(transposed)
     {
-        execute_dft(inv, out, in, temp);
+        size_t size = 1;
+        for (size_t radix : radices)
+            size *= radix;
+        this->stage_size = size;
+        this->data_size  = align_up(sizeof(u32) * size, native_cache_alignment);
+        this->temp_size  = align_up(sizeof(complex<T>) * size, native_cache_alignment);
     }
 
-    template <size_t Tag1, size_t Tag2, size_t Tag3>
-    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<complex<T>, Tag2>& in,
-                            univector<u8, Tag3>& temp, bool inverse = false) const
+protected:
+    std::vector<size_t> radices;
+    bool transposed;
+
+    virtual void do_initialize(size_t) override final
     {
-        if (inverse)
+        u32* table        = ptr_cast<u32>(this->data);
+        const size_t size = this->stage_size;
+        const size_t last = radices.back();
+        KFR_LOOP_NOUNROLL
+        for (size_t index = 0; index < size; index++)
+        {
+            size_t rest     = index;
+            size_t stride   = size;
+            size_t position = 0;
+            size_t digit    = 0;
+            for (size_t radix : radices)
+            {
+                stride /= radix;
+                digit = rest % radix;
+                rest /= radix;
+                position += digit * stride;
+            }
+            if (transposed)
+                position = (position - digit) / last + size / last * digit;
+            table[index] = static_cast<u32>(position);
+        }
+    }
+
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* temp) override final
+    {
+        const u32* table    = ptr_cast<u32>(this->data);
+        const size_t size   = this->stage_size;
+        complex<T>* scratch = ptr_cast<complex<T>>(temp);
+        builtin_memcpy(scratch, in, sizeof(complex<T>) * size);
+        KFR_LOOP_NOUNROLL
+        for (size_t index = 0; index < size; index++)
+            out[index] = scratch[table[index]];
+    }
+};
+
+template <bool conj_in, bool conj_out, typename T>
+KFR_INTRIN void cmul_range(complex<T>* out, const complex<T>* in, const complex<T>* mul, size_t size)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    size_t i               = 0;
+    KFR_LOOP_NOUNROLL
+    for (; i < size / width * width; i += width)
+    {
+        cvec<T, width> x = cread<width>(in + i);
+        x                = cmul(conj_in ? negodd(x) : x, cread<width>(mul + i));
+        cwrite<width>(out + i, conj_out ? negodd(x) : x);
+    }
+    KFR_LOOP_NOUNROLL
+    for (; i < size; i++)
+    {
+        cvec<T, 1> x = cread<1>(in + i);
+        x            = cmul(conj_in ? negodd(x) : x, cread<1>(mul + i));
+        cwrite<1>(out + i, conj_out ? negodd(x) : x);
+    }
+}
+
+/// Bluestein's algorithm: the DFT of any size is expressed as a circular convolution
+/// with a chirp and evaluated with power of two FFTs
+template <typename T, bool inverse>
+struct dft_chirpz_stage_impl : dft_stage<T>
+{
+    dft_chirpz_stage_impl(size_t size)
+        : fft_size(next_poweroftwo(2 * size - 1)), fft(new dft_plan<T>(fft_size))
+    {
+        this->stage_size = size;
+        this->data_size  = align_up(sizeof(complex<T>) * (size + fft_size), native_cache_alignment);
+        this->temp_size  = align_up(sizeof(complex<T>) * fft_size, native_cache_alignment) + fft->temp_size;
+    }
+
+protected:
+    size_t fft_size;
+    std::unique_ptr<dft_plan<T>> fft;
+
+    virtual void do_initialize(size_t) override final
+    {
+        const size_t size = this->stage_size;
+        complex<T>* chirp = ptr_cast<complex<T>>(this->data);
+        complex<T>* fir   = chirp + size;
+        KFR_LOOP_NOUNROLL
+        for (size_t n = 0; n < size; n++)
+        {
+            const cvec<T, 1> tw = calculate_twiddle<T>(n * n % (2 * size), 2 * size);
+            chirp[n]            = complex<T>(tw[0], tw[1]);
+        }
+        std::fill(fir, fir + fft_size, complex<T>(0));
+        fir[0] = complex<T>(chirp[0].real(), -chirp[0].imag());
+        KFR_LOOP_NOUNROLL
+        for (size_t n = 1; n < size; n++)
+        {
+            fir[n]            = complex<T>(chirp[n].real(), -chirp[n].imag());
+            fir[fft_size - n] = fir[n];
+        }
+        univector<u8> temp(fft->temp_size);
+        fft->execute(fir, fir, temp.data());
+        const T scale = T(1) / T(fft_size);
+        KFR_LOOP_NOUNROLL
+        for (size_t k = 0; k < fft_size; k++)
+            fir[k] = complex<T>(fir[k].real() * scale, fir[k].imag() * scale);
+    }
+
+    virtual void do_execute(complex<T>* out, const complex<T>* in, u8* temp) override final
+    {
+        const size_t size       = this->stage_size;
+        const complex<T>* chirp = ptr_cast<complex<T>>(this->data);
+        const complex<T>* fir   = chirp + size;
+        complex<T>* work        = ptr_cast<complex<T>>(temp);
+        u8* fft_temp            = temp + align_up(sizeof(complex<T>) * fft_size, native_cache_alignment);
+
+        // the inverse transform is computed as conj(DFT(conj(x)))
+        cmul_range<inverse, false>(work, in, chirp, size);
+        std::fill(work + size, work + fft_size, complex<T>(0));
+        fft->execute(work, work, fft_temp, cfalse);
+        cmul_range<false, false>(work, work, fir, fft_size);
+        fft->execute(work, work, fft_temp, ctrue);
+        cmul_range<false, inverse>(out, work, chirp, size);
+    }
+};
+
+template <typename T, bool splitin, bool is_even, bool prefetch, cpu_t cpu = cpu_t::native>
+struct fft_stage_impl_t
+{
+    template <bool inverse>
+    using type = internal::fft_stage_impl<T, splitin, is_even, prefetch, inverse, cpu>;
+};
+template <typename T, bool splitin, size_t size, cpu_t cpu = cpu_t::native>
+struct fft_final_stage_impl_t
+{
+    template <bool inverse>
+    using type = internal::fft_final_stage_impl<T, splitin, size, inverse, cpu>;
+};
+template <typename T, size_t log2n, bool prefetch, cpu_t cpu = cpu_t::native>
+struct fft_fused_stage_impl_t
+{
+    template <bool inverse>
+    using type = internal::fft_fused_stage_impl<T, log2n, prefetch, inverse, cpu>;
+};
+template <typename T, bool is_even, cpu_t cpu = cpu_t::native>
+struct fft_reorder_stage_impl_t
+{
+    template <bool>
+    using type = internal::fft_reorder_stage_impl<T, is_even, cpu>;
+};
+template <typename T, size_t log2n, bool aligned>
+struct fft_specialization_t
+{
+    template <bool inverse>
+    using type = internal::fft_specialization<T, log2n, inverse>;
+};
+template <typename T, size_t radix>
+struct dft_stage_fixed_impl_t
+{
+    template <bool inverse>
+    using type = internal::dft_stage_fixed_impl<T, radix, inverse>;
+};
+template <typename T, size_t radix>
+struct dft_stage_fixed_final_impl_t
+{
+    template <bool inverse>
+    using type = internal::dft_stage_fixed_final_impl<T, radix, inverse>;
+};
+template <typename T>
+struct dft_stage_generic_impl_t
+{
+    template <bool inverse>
+    using type = internal::dft_stage_generic_impl<T, inverse>;
+};
+template <typename T>
+struct dft_reorder_stage_impl_t
+{
+    template <bool>
+    using type = internal::dft_reorder_stage_impl<T>;
+};
+template <typename T>
+struct dft_chirpz_stage_impl_t
+{
+    template <bool inverse>
+    using type = internal::dft_chirpz_stage_impl<T, inverse>;
+};
+}
+
+namespace dft_type
+{
+constexpr cbools_t<true, true> both{};
+constexpr cbools_t<true, false> direct{};
+constexpr cbools_t<false, true> inverse{};
+}
+
+enum class dft_algorithm
+{
+    radix4, // radix-4 stages for power of two sizes, mixed radix stages otherwise
+    mixed   // mixed radix stages for all sizes
+};
+
+/// Stage decomposition choices. The defaults are used unless the wisdom has a measured
+/// configuration for the size
+struct dft_config
+{
+    dft_algorithm algorithm = dft_algorithm::radix4;
+    bool prefetch           = true; // prefetching in radix-4 passes
+    size_t radix_set        = 0;    // 0: radices 10..2, 1: without 10 and 6, 2: only 7, 5, 4, 3, 2
+    cpu_t cpu               = cpu_t::runtime; // instruction set of the radix-4 stages, runtime: best
+                                              // supported by the host
+
+    constexpr static size_t radix_sets = 3;
+
+    static bool radix_allowed(size_t radix, size_t radix_set)
+    {
+        switch (radix_set)
+        {
+        case 1:
+            return radix != 10 && radix != 6;
+        case 2:
+            return radix != 10 && radix != 8 && radix != 6;
+        default:
+            return true;
+        }
+    }
+};
+
+/// Process-wide table of measured configurations keyed by element size and transform size.
+/// It can be saved to and loaded from a plain text file with one configuration per line:
+/// <f32|f64> <size> <radix4|mixed> <prefetch> <radix_set>
+struct dft_wisdom
+{
+    static dft_wisdom& instance()
+    {
+        static dft_wisdom wisdom;
+        return wisdom;
+    }
+
+    template <typename T>
+    dft_config find(size_t size) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = configs.find(key_type(sizeof(T), size));
+        return it != configs.end() ? it->second : dft_config();
+    }
+    template <typename T>
+    bool contains(size_t size) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return configs.find(key_type(sizeof(T), size)) != configs.end();
+    }
+    template <typename T>
+    void add(size_t size, const dft_config& config)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        configs[key_type(sizeof(T), size)] = config;
+    }
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        configs.clear();
+    }
+
+    /// Merges the configurations from the file, returns false if it can't be read
+    bool load(const char* path)
+    {
+        FILE* file = fopen(path, "r");
+        if (!file)
+            return false;
+        char line[256];
+        std::lock_guard<std::mutex> lock(mutex);
+        while (fgets(line, sizeof(line), file))
+        {
+            char type[8], algorithm[16];
+            unsigned long long size;
+            int prefetch, radix_set;
+            if (line[0] == '#' ||
+                sscanf(line, "%7s %llu %15s %d %d", type, &size, algorithm, &prefetch, &radix_set) != 5)
+                continue;
+            const size_t element = strcmp(type, "f32") == 0 ? 4 : strcmp(type, "f64") == 0 ? 8 : 0;
+            if (!element || radix_set < 0 || size_t(radix_set) >= dft_config::radix_sets)
+                continue;
+            dft_config config;
+            config.algorithm = strcmp(algorithm, "mixed") == 0 ? dft_algorithm::mixed : dft_algorithm::radix4;
+            config.prefetch  = prefetch != 0;
+            config.radix_set = radix_set;
+            configs[key_type(element, size)] = config;
+        }
+        fclose(file);
+        return true;
+    }
+
+    /// Writes all configurations to the file, returns false on failure
+    bool save(const char* path) const
+    {
+        FILE* file = fopen(path, "w");
+        if (!file)
+            return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        fprintf(file, "# KFR dft wisdom\n");
+        for (const auto& item : configs)
+        {
+            const dft_config& config = item.second;
+            fprintf(file, "%s %llu %s %d %d\n", item.first.first == 4 ? "f32" : "f64",
+                    static_cast<unsigned long long>(item.first.second),
+                    config.algorithm == dft_algorithm::mixed ? "mixed" : "radix4", config.prefetch ? 1 : 0,
+                    static_cast<int>(config.radix_set));
+        }
+        return fclose(file) == 0;
+    }
+
+private:
+    using key_type = std::pair<size_t, size_t>;
+    dft_wisdom()   = default;
+    mutable std::mutex mutex;
+    std::map<key_type, dft_config> configs;
+};
+
+template <typename T>
+struct dft_plan
+{
+    using dft_stage_ptr = std::unique_ptr<dft_stage<T>>;
+
+    size_t size;
+    size_t temp_size;
+    dft_config config;
+
+    template <bool direct = true, bool inverse = true>
+    dft_plan(size_t size, cbools_t<direct, inverse> type = dft_type::both)
+        : dft_plan(size, dft_wisdom::instance().find<T>(size), type)
+    {
+    }
+
+    template <bool direct = true, bool inverse = true>
+    dft_plan(size_t size, const dft_config& config, cbools_t<direct, inverse> type = dft_type::both)
+        : size(size), temp_size(0), config(config), data_size(0)
+    {
+        if (size > 1 && is_poweroftwo(size) && config.algorithm == dft_algorithm::radix4)
+        {
+            if (this->config.cpu == cpu_t::runtime)
+                this->config.cpu = internal::dft_select_cpu();
+            cswitch(internal::dft_cpus, this->config.cpu, [&](auto cpu) { make_radix4(size, type, cpu); },
+                    [&]() {
+                        this->config.cpu = cpu_t::native;
+                        make_radix4(size, type, ccpu<cpu_t::native>);
+                    });
+        }
+        else
+        {
+            make_dft(size, type, config.radix_set);
+        }
+        initialize(type);
+        stages_temp_size = temp_size;
+    }
+
+    constexpr static size_t fourstep_min_size = 65536;
+
+    /// Transforms of at least fourstep_min_size points are split into cache-sized row and column
+    /// transforms (six-step algorithm) distributed over the given number of threads, the calling
+    /// thread included. 0 restores the default single pass execution. Updates temp_size
+    void set_threads(size_t threads)
+    {
+        fourstep.reset();
+        temp_size = stages_temp_size;
+        if (threads == 0 || size < fourstep_min_size)
+            return;
+        size_t rows = 1;
+        while ((rows + 1) * (rows + 1) <= size)
+            rows++;
+        while (size % rows != 0)
+            rows--;
+        if (rows < 16)
+            return;
+        fourstep.reset(new internal::dft_fourstep<T>(size, rows, threads));
+        temp_size = fourstep->temp_size;
+    }
+    size_t threads() const { return fourstep ? fourstep->threads : 0; }
+
+    /// Size of the twiddle and stage data in bytes
+    size_t data_size_bytes() const { return data_size; }
+
+    constexpr static size_t batch_max_size = 4096;
+
+    /// Builds the tables of the SIMD batch transform used by execute_batch for power of two sizes
+    /// up to batch_max_size. Plans that are never executed in batches do not pay for them. Updates
+    /// data_size_bytes() and batch_temp_size()
+    void enable_batch()
+    {
+        if (batch || size < 4 || size > batch_max_size || !is_poweroftwo(size))
+            return;
+        batch.reset(new internal::dft_batch<T>(size));
+        data_size += batch->data_size();
+    }
+
+    /// Executes count transforms. Sample n of transform i is read from in[i * distance + n * stride]
+    /// and written to out[i * distance + n * stride]. After enable_batch(), power of two sizes up to
+    /// batch_max_size process several transforms at once, one per SIMD lane. temp must hold
+    /// batch_temp_size() bytes
+    KFR_INTRIN void execute_batch(complex<T>* out, const complex<T>* in, u8* temp, size_t count, size_t stride,
+                                  size_t distance, bool inverse = false) const
+    {
+        if (inverse)
+            execute_batch(out, in, temp, count, stride, distance, ctrue);
+        else
+            execute_batch(out, in, temp, count, stride, distance, cfalse);
+    }
+    template <bool inverse>
+    void execute_batch(complex<T>* out, const complex<T>* in, u8* temp, size_t count, size_t stride,
+                       size_t distance, cbool_t<inverse>) const
+    {
+        if (batch)
+        {
+            batch->execute(cbool<inverse>, out, in, temp, count, stride, distance);
+        }
+        else if (stride == 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                execute_dft(cbool<inverse>, out + i * distance, in + i * distance, temp);
+        }
+        else
+        {
+            complex<T>* scratch = ptr_cast<complex<T>>(temp);
+            temp += align_up(sizeof(complex<T>) * size, native_cache_alignment);
+            for (size_t i = 0; i < count; i++)
+            {
+                for (size_t n = 0; n < size; n++)
+                    scratch[n] = in[i * distance + n * stride];
+                execute_dft(cbool<inverse>, scratch, scratch, temp);
+                for (size_t n = 0; n < size; n++)
+                    out[i * distance + n * stride] = scratch[n];
+            }
+        }
+    }
+    size_t batch_temp_size() const
+    {
+        return batch ? batch->temp_size
+                     : align_up(sizeof(complex<T>) * size, native_cache_alignment) + temp_size;
+    }
+
+    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, bool inverse = false) const
+    {
+        if (inverse)
+            execute_dft(ctrue, out, in, temp);
+        else
+            execute_dft(cfalse, out, in, temp);
+    }
+    template <bool inverse>
+    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, cbool_t<inverse> inv) const
+    {
+        execute_dft(inv, out, in, temp);
+    }
+
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<complex<T>, Tag2>& in,
+                            univector<u8, Tag3>& temp, bool inverse = false) const
+    {
+        if (inverse)
             execute_dft(ctrue, out.data(), in.data(), temp.data());
         else
             execute_dft(cfalse, out.data(), in.data(), temp.data());
@@ -867,58 +1692,229 @@ struct dft_plan
         execute_dft(inv, out.data(), in.data(), temp.data());
     }
 
+    /// Split-complex variant: real and imaginary parts are stored in separate arrays. The first
+    /// radix-4 pass reads this layout directly. temp must hold split_temp_size() bytes
+    KFR_INTRIN void execute(T* out_re, T* out_im, const T* in_re, const T* in_im, u8* temp,
+                            bool inverse = false) const
+    {
+        if (inverse)
+            execute_split(ctrue, out_re, out_im, in_re, in_im, temp);
+        else
+            execute_split(cfalse, out_re, out_im, in_re, in_im, temp);
+    }
+    template <bool inverse>
+    KFR_INTRIN void execute(T* out_re, T* out_im, const T* in_re, const T* in_im, u8* temp,
+                            cbool_t<inverse> inv) const
+    {
+        execute_split(inv, out_re, out_im, in_re, in_im, temp);
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3, size_t Tag4, size_t Tag5>
+    KFR_INTRIN void execute(univector<T, Tag1>& out_re, univector<T, Tag2>& out_im,
+                            const univector<T, Tag3>& in_re, const univector<T, Tag4>& in_im,
+                            univector<u8, Tag5>& temp, bool inverse = false) const
+    {
+        execute(out_re.data(), out_im.data(), in_re.data(), in_im.data(), temp.data(), inverse);
+    }
+    size_t split_temp_size() const
+    {
+        return align_up(sizeof(complex<T>) * size, native_cache_alignment) + temp_size;
+    }
+
+    /// Power of two sizes from this one end with a reordering pass, smaller ones have none
+    constexpr static size_t unordered_min_size = 512;
+
+    /// Builds the tables of execute_unordered for power of two sizes from unordered_min_size.
+    /// Updates data_size_bytes()
+    void enable_unordered()
+    {
+        if (unordered_impl || size < unordered_min_size || !is_poweroftwo(size))
+            return;
+        unordered_impl.reset(new internal::dft_unordered<T>(size));
+        data_size += unordered_impl->data_size();
+    }
+    /// True if execute_unordered skips the reordering, false if it produces the natural order
+    bool unordered() const { return static_cast<bool>(unordered_impl); }
+
+    /// Transform without the reordering pass, for pointwise products of spectra such as fast
+    /// convolution. After enable_unordered(), the direct transform writes bin k to out[bitreverse(k)]
+    /// and the inverse one reads its input in that order and writes the natural one, in the calling
+    /// thread. Otherwise both are the same as execute. out may be equal to in
+    KFR_INTRIN void execute_unordered(complex<T>* out, const complex<T>* in, u8* temp,
+                                      bool inverse = false) const
+    {
+        if (inverse)
+            execute_unordered(out, in, temp, ctrue);
+        else
+            execute_unordered(out, in, temp, cfalse);
+    }
+    template <bool inverse>
+    void execute_unordered(complex<T>* out, const complex<T>* in, u8* temp, cbool_t<inverse>) const
+    {
+        if (unordered_impl)
+            unordered_impl->execute(cbool<inverse>, out, in);
+        else
+            execute_dft(cbool<inverse>, out, in, temp);
+    }
+
 private:
     autofree<u8> data;
     size_t data_size;
+    size_t stages_temp_size;
     std::vector<dft_stage_ptr> stages[2];
-    template <template <bool inverse> class Stage>
-    void add_stage(size_t stage_size, cbools_t<true, true>)
+    std::unique_ptr<internal::dft_fourstep<T>> fourstep;
+    std::unique_ptr<internal::dft_batch<T>> batch;
+    std::unique_ptr<internal::dft_unordered<T>> unordered_impl;
+    template <template <bool inverse> class Stage, typename... Args>
+    void add_stage(cbools_t<true, true>, Args... args)
     {
-        dft_stage<T>* direct_stage  = new Stage<false>(stage_size);
+        dft_stage<T>* direct_stage  = new Stage<false>(args...);
         direct_stage->name          = type_name<decltype(*direct_stage)>();
-        dft_stage<T>* inverse_stage = new Stage<true>(stage_size);
+        dft_stage<T>* inverse_stage = new Stage<true>(args...);
         inverse_stage->name         = type_name<decltype(*inverse_stage)>();
         this->data_size += direct_stage->data_size;
         this->temp_size += direct_stage->temp_size;
         stages[0].push_back(dft_stage_ptr(direct_stage));
         stages[1].push_back(dft_stage_ptr(inverse_stage));
     }
-    template <template <bool inverse> class Stage>
-    void add_stage(size_t stage_size, cbools_t<true, false>)
+    template <template <bool inverse> class Stage, typename... Args>
+    void add_stage(cbools_t<true, false>, Args... args)
     {
-        dft_stage<T>* direct_stage = new Stage<false>(stage_size);
+        dft_stage<T>* direct_stage = new Stage<false>(args...);
         direct_stage->name         = type_name<decltype(*direct_stage)>();
         this->data_size += direct_stage->data_size;
         this->temp_size += direct_stage->temp_size;
         stages[0].push_back(dft_stage_ptr(direct_stage));
     }
-    template <template <bool inverse> class Stage>
-    void add_stage(size_t stage_size, cbools_t<false, true>)
+    template <template <bool inverse> class Stage, typename... Args>
+    void add_stage(cbools_t<false, true>, Args... args)
     {
-        dft_stage<T>* inverse_stage = new Stage<true>(stage_size);
+        dft_stage<T>* inverse_stage = new Stage<true>(args...);
         inverse_stage->name         = type_name<decltype(*inverse_stage)>();
         this->data_size += inverse_stage->data_size;
         this->temp_size += inverse_stage->temp_size;
         stages[1].push_back(dft_stage_ptr(inverse_stage));
     }
 
-    template <bool direct, bool inverse, bool is_even, bool first>
-    void make_fft(size_t stage_size, cbools_t<direct, inverse> type, cbool_t<is_even>, cbool_t<first>)
+    // Power of two sizes: fixed size transforms up to 256, fused radix-4 chains up to 16384, then
+    // recursive radix-4 stages, all built for the given instruction set
+    template <bool direct, bool inverse, cpu_t cpu>
+    void make_radix4(size_t size, cbools_t<direct, inverse> type, ccpu_t<cpu>)
+    {
+        const size_t log2n = ilog2(size);
+        cswitch(csizes<1, 2, 3, 4, 5, 6, 7, 8>, log2n,
+                [&](auto log2n) {
+                    add_stage<internal::fft_specialization_t<T, val_of(log2n), false>::template type>(type,
+                                                                                                      size);
+                },
+                [&]() {
+                    cswitch(cfalse_true, is_even(log2n), [&](auto is_even) {
+                        cswitch(cfalse_true, config.prefetch, [&](auto prefetch) {
+                            cswitch(csizes<9, 10, 11, 12, 13, 14>, log2n,
+                                    [&](auto log2n) {
+                                        add_stage<internal::fft_fused_stage_impl_t<
+                                            T, val_of(log2n), val_of(prefetch), cpu>::template type>(type,
+                                                                                                     size);
+                                    },
+                                    [&]() { make_fft(size, type, is_even, prefetch, ctrue, ccpu<cpu>); });
+                        });
+                        add_stage<internal::fft_reorder_stage_impl_t<T, val_of(is_even), cpu>::template type>(
+                            type, size);
+                    });
+                });
+    }
+
+    template <bool direct, bool inverse, bool is_even, bool prefetch, bool first, cpu_t cpu>
+    void make_fft(size_t stage_size, cbools_t<direct, inverse> type, cbool_t<is_even>, cbool_t<prefetch>,
+                  cbool_t<first>, ccpu_t<cpu>)
     {
         constexpr size_t final_size = is_even ? 1024 : 512;
 
-        using fft_stage_impl_t       = internal::fft_stage_impl_t<T, !first, is_even>;
-        using fft_final_stage_impl_t = internal::fft_final_stage_impl_t<T, !first, final_size>;
+        using fft_stage_impl_t       = internal::fft_stage_impl_t<T, !first, is_even, prefetch, cpu>;
+        using fft_final_stage_impl_t = internal::fft_final_stage_impl_t<T, !first, final_size, cpu>;
 
         if (stage_size >= 2048)
         {
-            add_stage<fft_stage_impl_t::template type>(stage_size, type);
+            add_stage<fft_stage_impl_t::template type>(type, stage_size);
 
-            make_fft(stage_size / 4, cbools<direct, inverse>, cbool<is_even>, cfalse);
+            make_fft(stage_size / 4, cbools<direct, inverse>, cbool<is_even>, cbool<prefetch>, cfalse,
+                     ccpu<cpu>);
         }
         else
         {
-            add_stage<fft_final_stage_impl_t::template type>(final_size, type);
+            add_stage<fft_final_stage_impl_t::template type>(type, final_size);
+        }
+    }
+
+    template <bool direct, bool inverse>
+    void make_dft(size_t size, cbools_t<direct, inverse> type, size_t radix_set)
+    {
+        const size_t max_generic_radix = 100;
+
+        // an empty transform has no stages
+        if (size == 0)
+            return;
+
+        std::vector<size_t> radices;
+        size_t fixed_count = 0;
+        size_t rest        = size;
+        cforeach(csizes<10, 8, 7, 6, 5, 4, 3, 2>, [&](auto radix) {
+            if (!dft_config::radix_allowed(val_of(radix), radix_set))
+                return;
+            while (rest % val_of(radix) == 0)
+            {
+                radices.push_back(val_of(radix));
+                rest /= val_of(radix);
+            }
+        });
+        fixed_count = radices.size();
+        for (size_t prime = 11; prime * prime <= rest; prime += 2)
+        {
+            while (rest % prime == 0)
+            {
+                radices.insert(radices.begin(), prime);
+                rest /= prime;
+            }
+        }
+        if (rest > 1 || radices.empty())
+            radices.insert(radices.begin(), rest);
+
+        if (radices.front() > max_generic_radix)
+        {
+            add_stage<internal::dft_chirpz_stage_impl_t<T>::template type>(type, size);
+            return;
+        }
+
+        // generic primes go first, the fixed radices with fused butterflies follow,
+        // the last one of them writes its output transposed
+        const size_t generic_count = radices.size() - fixed_count;
+        size_t iterations          = size;
+        size_t blocks              = 1;
+        for (size_t stage = 0; stage < radices.size(); stage++)
+        {
+            const size_t radix = radices[stage];
+            iterations /= radix;
+            if (stage < generic_count)
+            {
+                add_stage<internal::dft_stage_generic_impl_t<T>::template type>(type, radix, iterations,
+                                                                                blocks);
+            }
+            else
+            {
+                cswitch(csizes<10, 8, 7, 6, 5, 4, 3, 2>, radix, [&](auto radix) {
+                    if (iterations == 1)
+                        add_stage<internal::dft_stage_fixed_final_impl_t<T, val_of(radix)>::template type>(
+                            type, blocks);
+                    else
+                        add_stage<internal::dft_stage_fixed_impl_t<T, val_of(radix)>::template type>(
+                            type, iterations, blocks);
+                });
+            }
+            blocks *= radix;
+        }
+        const bool transposed = fixed_count > 0;
+        if (radices.size() > 2 || (radices.size() == 2 && !transposed))
+        {
+            add_stage<internal::dft_reorder_stage_impl_t<T>::template type>(type, radices, transposed);
         }
     }
 
@@ -949,8 +1945,19 @@ private:
         }
     }
     template <bool inverse>
-    KFR_INTRIN void execute_dft(cbool_t<inverse>, complex<T>* out, const complex<T>* in, u8* temp) const
+    KFR_INTRIN void execute_dft(cbool_t<inverse>, complex<T>* out, const complex<T>* in, u8* temp,
+                                const T* split_re = nullptr, const T* split_im = nullptr) const
     {
+        if (fourstep)
+        {
+            if (split_re)
+            {
+                internal::interleave_split(out, split_re, split_im, size);
+                in = out;
+            }
+            fourstep->execute(cbool<inverse>, out, in, temp);
+            return;
+        }
         size_t stack[32] = { 0 };
 
         const size_t count = stages[inverse].size();
@@ -972,7 +1979,7 @@ private:
                     }
                     else
                     {
-                        stages[inverse][rdepth]->execute(rout, rin, temp);
+                        execute_stage(*stages[inverse][rdepth], rout, rin, temp, split_re, split_im);
                         rout += stages[inverse][rdepth]->out_offset;
                         rin = rout;
                         stack[rdepth]++;
@@ -986,12 +1993,991 @@ private:
             }
             else
             {
-                stages[inverse][depth]->execute(out, in, temp);
+                execute_stage(*stages[inverse][depth], out, in, temp, split_re, split_im);
                 depth++;
             }
             in = out;
         }
     }
+    template <bool inverse>
+    KFR_INTRIN void execute_split(cbool_t<inverse>, T* out_re, T* out_im, const T* in_re, const T* in_im,
+                                  u8* temp) const
+    {
+        complex<T>* work = ptr_cast<complex<T>>(temp);
+        execute_dft(cbool<inverse>, work, work, temp + align_up(sizeof(complex<T>) * size, native_cache_alignment),
+                    in_re, in_im);
+        internal::deinterleave_split(out_re, out_im, work, size);
+    }
+    KFR_INTRIN void execute_stage(dft_stage<T>& stage, complex<T>* out, const complex<T>* in, u8* temp,
+                                  const T*& split_re, const T*& split_im) const
+    {
+        if (split_re)
+        {
+            if (stage.split_input)
+            {
+                stage.execute_split(out, split_re, split_im, temp);
+            }
+            else
+            {
+                internal::interleave_split(out, split_re, split_im, size);
+                stage.execute(out, out, temp);
+            }
+            split_re = split_im = nullptr;
+        }
+        else
+        {
+            stage.execute(out, in, temp);
+        }
+    }
+};
+
+/// Times every candidate configuration for the size, stores the fastest one in the wisdom
+/// and returns it. Plans created afterwards for this size use the measured configuration
+template <typename T>
+dft_config dft_measure(size_t size)
+{
+    std::vector<dft_config> candidates;
+    dft_config config;
+    if (size > 1 && is_poweroftwo(size))
+    {
+        candidates.push_back(config);
+        config.prefetch = false;
+        candidates.push_back(config);
+        config.algorithm = dft_algorithm::mixed;
+        config.prefetch  = true;
+        config.radix_set = 0;
+        candidates.push_back(config);
+        config.radix_set = 2;
+        candidates.push_back(config);
+    }
+    else
+    {
+        for (size_t radix_set = 0; radix_set < dft_config::radix_sets; radix_set++)
+        {
+            config.radix_set = radix_set;
+            candidates.push_back(config);
+        }
+    }
+
+    // the input is never overwritten, so repeated unnormalized transforms can't overflow it
+    const univector<complex<T>> input(size, complex<T>(T(1), T(-1)));
+    univector<complex<T>> output(size);
+    dft_config best = candidates.front();
+    double best_time = std::numeric_limits<double>::max();
+    for (const dft_config& candidate : candidates)
+    {
+        const dft_plan<T> plan(size, candidate);
+        univector<u8> temp(plan.temp_size);
+        plan.execute(output, input, temp);
+
+        using clock           = std::chrono::steady_clock;
+        const auto start      = clock::now();
+        size_t runs           = 0;
+        double elapsed        = 0;
+        do
+        {
+            plan.execute(output, input, temp);
+            runs++;
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        } while (runs < 4 || elapsed < 0.01);
+        if (elapsed / runs < best_time)
+        {
+            best_time = elapsed / runs;
+            best      = candidate;
+        }
+    }
+    dft_wisdom::instance().add<T>(size, best);
+    return best;
+}
+
+namespace internal
+{
+
+// 4x4 complex block: four rows are read as vectors and transposed in registers
+template <typename T>
+KFR_INTRIN void transpose_block4(complex<T>* out, const complex<T>* in, size_t rows, size_t cols)
+{
+    cvec<T, 16> v =
+        concat(cread<4>(in), cread<4>(in + cols), cread<4>(in + cols * 2), cread<4>(in + cols * 3));
+    v = digitreverse4<2>(v);
+    cwrite<4>(out, part<4, 0>(v));
+    cwrite<4>(out + rows, part<4, 1>(v));
+    cwrite<4>(out + rows * 2, part<4, 2>(v));
+    cwrite<4>(out + rows * 3, part<4, 3>(v));
+}
+
+template <typename T>
+void transpose_rows(complex<T>* out, const complex<T>* in, size_t rows, size_t cols, size_t row_begin,
+                    size_t row_end)
+{
+    constexpr size_t block = 16;
+    KFR_LOOP_NOUNROLL
+    for (size_t r0 = row_begin; r0 < row_end; r0 += block)
+    {
+        const size_t r1 = std::min(r0 + block, row_end);
+        KFR_LOOP_NOUNROLL
+        for (size_t c0 = 0; c0 < cols; c0 += block)
+        {
+            const size_t c1 = std::min(c0 + block, cols);
+            size_t r        = r0;
+            for (; r + 4 <= r1; r += 4)
+            {
+                size_t c = c0;
+                for (; c + 4 <= c1; c += 4)
+                    transpose_block4(out + c * rows + r, in + r * cols + c, rows, cols);
+                for (; c < c1; c++)
+                    for (size_t i = 0; i < 4; i++)
+                        out[c * rows + r + i] = in[(r + i) * cols + c];
+            }
+            for (; r < r1; r++)
+                for (size_t c = c0; c < c1; c++)
+                    out[c * rows + r] = in[r * cols + c];
+        }
+    }
+}
+
+/// Six-step algorithm: for size = n1 * n2, the input viewed as an n1 x n2 matrix is transposed,
+/// n2 transforms of size n1 are applied to the rows and multiplied by twiddles, the matrix is
+/// transposed back, n1 transforms of size n2 are applied and the result is transposed again.
+/// Each pass is distributed over the threads
+template <typename T>
+struct dft_fourstep
+{
+    dft_fourstep(size_t size, size_t n1, size_t threads)
+        : size(size), n1(n1), n2(size / n1), threads(threads), plan1(n1), plan2(n2), tw1(n1), tw2(n2),
+          pool(threads)
+    {
+        thread_temp_size = align_up(std::max(plan1.temp_size, plan2.temp_size), native_cache_alignment);
+        temp_size = align_up(sizeof(complex<T>) * size, native_cache_alignment) + thread_temp_size * threads;
+        for (size_t j = 0; j < n1; j++)
+        {
+            const cvec<T, 1> tw = calculate_twiddle<T>(j, size);
+            tw1[j]              = complex<T>(tw[0], tw[1]);
+        }
+        for (size_t j = 0; j < n2; j++)
+        {
+            const cvec<T, 1> tw = calculate_twiddle<T>(j * n1, size);
+            tw2[j]              = complex<T>(tw[0], tw[1]);
+        }
+    }
+
+    template <bool inverse>
+    void execute(cbool_t<inverse>, complex<T>* out, const complex<T>* in, u8* temp)
+    {
+        complex<T>* scratch = ptr_cast<complex<T>>(temp);
+        u8* thread_temp     = temp + align_up(sizeof(complex<T>) * size, native_cache_alignment);
+        complex<T>* first   = in == out ? scratch : out;
+        complex<T>* second  = in == out ? out : scratch;
+
+        transpose(first, in, n1, n2);
+        for_rows(n2, thread_temp, [&](size_t row, u8* t) {
+            plan1.execute(first + row * n1, first + row * n1, t, cbool<inverse>);
+            apply_twiddles(cbool<inverse>, first + row * n1, row);
+        });
+        transpose(second, first, n2, n1);
+        for_rows(n1, thread_temp, [&](size_t row, u8* t) {
+            plan2.execute(second + row * n2, second + row * n2, t, cbool<inverse>);
+        });
+        transpose(first, second, n1, n2);
+        if (first != out)
+            builtin_memcpy(out, first, sizeof(complex<T>) * size);
+    }
+
+    const size_t size;
+    const size_t n1;
+    const size_t n2;
+    const size_t threads;
+    size_t temp_size;
+
+private:
+    dft_plan<T> plan1;
+    dft_plan<T> plan2;
+    univector<complex<T>> tw1; // W^j, j < n1
+    univector<complex<T>> tw2; // W^(j * n1), j < n2
+    size_t thread_temp_size;
+    thread_pool pool;
+
+    template <typename Fn>
+    void for_rows(size_t rows, u8* thread_temp, Fn&& fn)
+    {
+        pool.parallel_for(threads, [&](size_t thread) {
+            u8* t = thread_temp + thread * thread_temp_size;
+            for (size_t row = rows * thread / threads; row < rows * (thread + 1) / threads; row++)
+                fn(row, t);
+        });
+    }
+
+    void transpose(complex<T>* out, const complex<T>* in, size_t rows, size_t cols)
+    {
+        pool.parallel_for(threads, [&](size_t thread) {
+            transpose_rows(out, in, rows, cols, rows * thread / threads, rows * (thread + 1) / threads);
+        });
+    }
+
+    // multiplies element k of the row by W^(row * k) = tw1[row * k % n1] * tw2[row * k / n1]
+    template <bool inverse>
+    void apply_twiddles(cbool_t<inverse>, complex<T>* data, size_t row) const
+    {
+        const size_t step_lo = row % n1;
+        const size_t step_hi = row / n1;
+        size_t lo            = 0;
+        size_t hi            = 0;
+        KFR_LOOP_NOUNROLL
+        for (size_t k = 0; k < n1; k++)
+        {
+            const cvec<T, 1> w = cmul(cread<1>(tw1.data() + lo), cread<1>(tw2.data() + hi));
+            const cvec<T, 1> x = cread<1>(data + k);
+            cwrite<1>(data + k, inverse ? cmul_conj(x, w) : cmul(x, w));
+            lo += step_lo;
+            hi += step_hi;
+            if (lo >= n1)
+            {
+                lo -= n1;
+                hi++;
+            }
+        }
+    }
+};
+}
+
+namespace internal
+{
+
+/// Radix-4 Stockham transform applied to `lanes` transforms at once. Sample n of all transforms
+/// is stored as one cvec<T, lanes>, so every butterfly processes a full vector of transforms
+template <typename T>
+struct dft_batch
+{
+    constexpr static size_t lanes = vector_width<T, cpu_t::native>;
+
+    dft_batch(size_t size) : size(size)
+    {
+        size_t tw_size = 0;
+        for (size_t n = size; n >= 4; n /= 4)
+            tw_size += 3 * (n / 4);
+        twiddle = univector<complex<T>>(tw_size);
+        complex<T>* tw = twiddle.data();
+        for (size_t n = size; n >= 4; n /= 4)
+        {
+            for (size_t p = 0; p < n / 4; p++)
+            {
+                for (size_t j = 1; j < 4; j++)
+                {
+                    const cvec<T, 1> w = calculate_twiddle<T>(p * j, n);
+                    *tw++              = complex<T>(w[0], w[1]);
+                }
+            }
+        }
+        temp_size = align_up(sizeof(complex<T>) * size * lanes * 2, native_cache_alignment);
+    }
+
+    size_t data_size() const { return sizeof(complex<T>) * twiddle.size(); }
+
+    template <bool inverse>
+    void execute(cbool_t<inverse>, complex<T>* out, const complex<T>* in, u8* temp, size_t count,
+                 size_t stride, size_t distance) const
+    {
+        complex<T>* x = ptr_cast<complex<T>>(temp);
+        complex<T>* y = x + size * lanes;
+        for (size_t first = 0; first < count; first += lanes)
+        {
+            const size_t active = std::min(lanes, count - first);
+            for (size_t n = 0; n < size; n++)
+            {
+                for (size_t l = 0; l < active; l++)
+                    x[n * lanes + l] = in[(first + l) * distance + n * stride];
+                for (size_t l = active; l < lanes; l++)
+                    x[n * lanes + l] = complex<T>(0);
+            }
+            const complex<T>* result = transform(cbool<inverse>, x, y);
+            for (size_t n = 0; n < size; n++)
+                for (size_t l = 0; l < active; l++)
+                    out[(first + l) * distance + n * stride] = result[n * lanes + l];
+        }
+    }
+
+    const size_t size;
+    size_t temp_size;
+
+private:
+    univector<complex<T>> twiddle;
+
+    template <bool inverse>
+    const complex<T>* transform(cbool_t<inverse>, complex<T>* x, complex<T>* y) const
+    {
+        const complex<T>* tw = twiddle.data();
+        size_t s             = 1;
+        size_t n             = size;
+        for (; n >= 4; n /= 4, s *= 4)
+        {
+            const size_t m = n / 4;
+            KFR_LOOP_NOUNROLL
+            for (size_t p = 0; p < m; p++, tw += 3)
+            {
+                const cvec<T, 1> w1 = cread<1>(tw + 0);
+                const cvec<T, 1> w2 = cread<1>(tw + 1);
+                const cvec<T, 1> w3 = cread<1>(tw + 2);
+                KFR_LOOP_NOUNROLL
+                for (size_t q = 0; q < s; q++)
+                {
+                    const cvec<T, lanes> a   = cread<lanes, true>(x + (q + s * (p + 0 * m)) * lanes);
+                    const cvec<T, lanes> b   = cread<lanes, true>(x + (q + s * (p + 1 * m)) * lanes);
+                    const cvec<T, lanes> c   = cread<lanes, true>(x + (q + s * (p + 2 * m)) * lanes);
+                    const cvec<T, lanes> d   = cread<lanes, true>(x + (q + s * (p + 3 * m)) * lanes);
+                    const cvec<T, lanes> apc = a + c;
+                    const cvec<T, lanes> amc = a - c;
+                    const cvec<T, lanes> bpd = b + d;
+                    // -i * (b - d) for the direct transform, +i * (b - d) for the inverse one
+                    const cvec<T, lanes> jbmd =
+                        inverse ? swap<2>(negodd(b - d)) : negodd(swap<2>(b - d));
+                    cwrite<lanes, true>(y + (q + s * (4 * p + 0)) * lanes, apc + bpd);
+                    cwrite<lanes, true>(y + (q + s * (4 * p + 1)) * lanes,
+                                        inverse ? cmul_conj(amc + jbmd, w1) : cmul(amc + jbmd, w1));
+                    cwrite<lanes, true>(y + (q + s * (4 * p + 2)) * lanes,
+                                        inverse ? cmul_conj(apc - bpd, w2) : cmul(apc - bpd, w2));
+                    cwrite<lanes, true>(y + (q + s * (4 * p + 3)) * lanes,
+                                        inverse ? cmul_conj(amc - jbmd, w3) : cmul(amc - jbmd, w3));
+                }
+            }
+            std::swap(x, y);
+        }
+        if (n == 2)
+        {
+            KFR_LOOP_NOUNROLL
+            for (size_t q = 0; q < s; q++)
+            {
+                const cvec<T, lanes> a = cread<lanes, true>(x + q * lanes);
+                const cvec<T, lanes> b = cread<lanes, true>(x + (q + s) * lanes);
+                cwrite<lanes, true>(y + q * lanes, a + b);
+                cwrite<lanes, true>(y + (q + s) * lanes, a - b);
+            }
+            std::swap(x, y);
+        }
+        return x;
+    }
+};
+
+/// In-place power of two transform by radix-2^2 passes, each fusing two radix-2 passes of
+/// decimation in frequency into one radix-4 pass. The direct transform leaves bin k at
+/// bitreverse(k) and has no reordering pass. The inverse one runs the transposed network
+/// (decimation in time) with conjugate twiddles, so it reads that order and writes the natural one
+template <typename T>
+struct dft_unordered
+{
+    dft_unordered(size_t size) : size(size)
+    {
+        size_t tw_size = 0;
+        for (size_t n = size; n >= 4; n /= 4)
+            tw_size += 3 * (n / 4);
+        twiddle = univector<complex<T>>(tw_size);
+        // rows of w^p, w^2p and w^3p for each pass, from the largest span to the smallest
+        complex<T>* tw = twiddle.data();
+        for (size_t n = size; n >= 4; n /= 4)
+        {
+            const size_t m = n / 4;
+            for (size_t j = 1; j < 4; j++)
+                for (size_t p = 0; p < m; p++)
+                {
+                    const cvec<T, 1> w  = calculate_twiddle<T>(p * j, n);
+                    tw[(j - 1) * m + p] = complex<T>(w[0], w[1]);
+                }
+            tw += 3 * m;
+        }
+    }
+
+    size_t data_size() const { return sizeof(complex<T>) * twiddle.size(); }
+
+    template <bool inverse>
+    void execute(cbool_t<inverse>, complex<T>* out, const complex<T>* in) const
+    {
+        if (out != in)
+            builtin_memcpy(out, in, sizeof(complex<T>) * size);
+        // an odd number of radix-2 passes leaves one pass of span 2
+        const bool odd = ilog2(size) % 2 == 1;
+        if (inverse)
+        {
+            if (odd)
+                radix2(out);
+            const complex<T>* tw = twiddle.data() + twiddle.size();
+            for (size_t n = odd ? 8 : 4; n <= size; n *= 4)
+            {
+                tw -= 3 * (n / 4);
+                pass(cbool<inverse>, out, tw, n);
+            }
+        }
+        else
+        {
+            const complex<T>* tw = twiddle.data();
+            for (size_t n = size; n >= 4; n /= 4)
+            {
+                pass(cbool<inverse>, out, tw, n);
+                tw += 3 * (n / 4);
+            }
+            if (odd)
+                radix2(out);
+        }
+    }
+
+    const size_t size;
+
+private:
+    univector<complex<T>> twiddle;
+
+    template <bool inverse>
+    void pass(cbool_t<inverse>, complex<T>* x, const complex<T>* tw, size_t n) const
+    {
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+        const size_t m         = n / 4;
+        KFR_LOOP_NOUNROLL
+        for (size_t b = 0; b < size; b += n)
+        {
+            size_t p = 0;
+            KFR_LOOP_NOUNROLL
+            for (; p + width <= m; p += width)
+                butterfly<width>(cbool<inverse>, x + b + p, tw + p, m);
+            KFR_LOOP_NOUNROLL
+            for (; p < m; p++)
+                butterfly<1>(cbool<inverse>, x + b + p, tw + p, m);
+        }
+    }
+
+    // Direct: radix-2 passes of span 4m and 2m, then the twiddles w^2p, w^p, w^3p of the outputs.
+    // Inverse: the conjugate twiddles of the inputs, then the transposed butterfly
+    template <size_t width, bool inverse>
+    KFR_INTRIN static void butterfly(cbool_t<inverse>, complex<T>* x, const complex<T>* tw, size_t m)
+    {
+        const cvec<T, width> w1 = cread<width>(tw);
+        const cvec<T, width> w2 = cread<width>(tw + m);
+        const cvec<T, width> w3 = cread<width>(tw + m * 2);
+        const cvec<T, width> x0 = cread<width>(x);
+        const cvec<T, width> x1 = cread<width>(x + m);
+        const cvec<T, width> x2 = cread<width>(x + m * 2);
+        const cvec<T, width> x3 = cread<width>(x + m * 3);
+        if (inverse)
+        {
+            const cvec<T, width> u1 = cmul_conj(x1, w2);
+            const cvec<T, width> u2 = cmul_conj(x2, w1);
+            const cvec<T, width> u3 = cmul_conj(x3, w3);
+            const cvec<T, width> a  = x0 + u1;
+            const cvec<T, width> b  = x0 - u1;
+            const cvec<T, width> c  = u2 + u3;
+            // i * (u2 - u3)
+            const cvec<T, width> d = swap<2>(negodd(u2 - u3));
+            cwrite<width>(x, a + c);
+            cwrite<width>(x + m, b + d);
+            cwrite<width>(x + m * 2, a - c);
+            cwrite<width>(x + m * 3, b - d);
+        }
+        else
+        {
+            const cvec<T, width> s02 = x0 + x2;
+            const cvec<T, width> d02 = x0 - x2;
+            const cvec<T, width> s13 = x1 + x3;
+            // -i * (x1 - x3)
+            const cvec<T, width> d13 = negodd(swap<2>(x1 - x3));
+            cwrite<width>(x, s02 + s13);
+            cwrite<width>(x + m, cmul(s02 - s13, w2));
+            cwrite<width>(x + m * 2, cmul(d02 + d13, w1));
+            cwrite<width>(x + m * 3, cmul(d02 - d13, w3));
+        }
+    }
+
+    // the same for both directions up to a factor of 2
+    void radix2(complex<T>* x) const
+    {
+        KFR_LOOP_NOUNROLL
+        for (size_t b = 0; b < size; b += 2)
+        {
+            const cvec<T, 1> a = cread<1>(x + b);
+            const cvec<T, 1> c = cread<1>(x + b + 1);
+            cwrite<1>(x + b, a + c);
+            cwrite<1>(x + b + 1, a - c);
+        }
+    }
+};
+}
+
+enum class dft_pack_format
+{
+    Perm, // {X[0].r, X[N/2].r}, X[1], ..., X[N/2-1]
+    CCs   // X[0], X[1], ..., X[N/2-1], X[N/2]
+};
+
+/// Real-to-complex and complex-to-real transform of even size built on top of a complex
+/// plan of size N/2. The direct transform writes N/2+1 (CCs) or N/2 (Perm) complex values,
+/// the inverse one reads the same layout. As for dft_plan, the inverse transform is unnormalized
+template <typename T>
+struct dft_plan_real
+{
+    size_t size;
+    size_t temp_size;
+
+    template <bool direct = true, bool inverse = true>
+    dft_plan_real(size_t size, cbools_t<direct, inverse> type = dft_type::both)
+        : size(size), temp_size(0), plan(size / 2, type), rtwiddle(size / 4 + 1)
+    {
+        temp_size = plan.temp_size;
+        for (size_t k = 0; k < rtwiddle.size(); k++)
+        {
+            const cvec<T, 1> tw = internal::calculate_twiddle<T>(k, size);
+            rtwiddle[k]         = complex<T>(tw[0], tw[1]);
+        }
+    }
+
+    KFR_INTRIN void execute(complex<T>* out, const T* in, u8* temp,
+                            dft_pack_format fmt = dft_pack_format::CCs) const
+    {
+        plan.execute(out, ptr_cast<complex<T>>(in), temp, cfalse);
+        to_fmt(out, fmt);
+    }
+    KFR_INTRIN void execute(T* out, const complex<T>* in, u8* temp,
+                            dft_pack_format fmt = dft_pack_format::CCs) const
+    {
+        complex<T>* cout = ptr_cast<complex<T>>(out);
+        from_fmt(cout, in, fmt);
+        plan.execute(cout, cout, temp, ctrue);
+    }
+
+    /// Builds the tables of execute_unordered if the complex plan of size N/2 supports it, see
+    /// dft_plan::enable_unordered. Updates data_size_bytes()
+    void enable_unordered()
+    {
+        plan.enable_unordered();
+        if (!plan.unordered() || !rtwiddle_unordered.empty())
+            return;
+        const size_t csize = size / 2;
+        const size_t bits  = ilog2(csize);
+        rtwiddle_unordered = univector<complex<T>>(csize);
+        // W^k for the bin k stored at position j
+        for (size_t j = 0; j < csize; j++)
+        {
+            const size_t k        = internal::bitrev_using_table(u32(j), bits);
+            const cvec<T, 1> tw   = internal::calculate_twiddle<T>(k, size);
+            rtwiddle_unordered[j] = complex<T>(tw[0], tw[1]);
+        }
+    }
+    bool unordered() const { return plan.unordered(); }
+
+    /// Transform of N/2+1 bins in an order of its own, for pointwise products of spectra such as
+    /// fast convolution. After enable_unordered(), bins 0 and N/2 are at 0 and N/2 and the others at
+    /// the bit-reversed positions of the complex transform, so neither direction has a reordering
+    /// pass. Otherwise the layout is CCs
+    KFR_INTRIN void execute_unordered(complex<T>* out, const T* in, u8* temp) const
+    {
+        if (plan.unordered())
+        {
+            plan.execute_unordered(out, ptr_cast<complex<T>>(in), temp, cfalse);
+            to_fmt_unordered(out);
+        }
+        else
+            execute(out, in, temp);
+    }
+    /// Inverse of the above, reads N/2+1 bins in the same order
+    KFR_INTRIN void execute_unordered(T* out, const complex<T>* in, u8* temp) const
+    {
+        if (plan.unordered())
+        {
+            complex<T>* cout = ptr_cast<complex<T>>(out);
+            from_fmt_unordered(cout, in);
+            plan.execute_unordered(cout, cout, temp, ctrue);
+        }
+        else
+            execute(out, in, temp);
+    }
+
+    /// Size of the twiddle and stage data in bytes
+    size_t data_size_bytes() const
+    {
+        return plan.data_size_bytes() + sizeof(complex<T>) * (rtwiddle.size() + rtwiddle_unordered.size());
+    }
+
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<T, Tag2>& in,
+                            univector<u8, Tag3>& temp, dft_pack_format fmt = dft_pack_format::CCs) const
+    {
+        execute(out.data(), in.data(), temp.data(), fmt);
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<T, Tag1>& out, const univector<complex<T>, Tag2>& in,
+                            univector<u8, Tag3>& temp, dft_pack_format fmt = dft_pack_format::CCs) const
+    {
+        execute(out.data(), in.data(), temp.data(), fmt);
+    }
+
+private:
+    dft_plan<T> plan;
+    univector<complex<T>> rtwiddle;
+    univector<complex<T>> rtwiddle_unordered;
+
+    // X[k] = (Z[k] + conj(Z[N/2-k])) / 2 - i * W^k * (Z[k] - conj(Z[N/2-k])) / 2
+    void to_fmt(complex<T>* out, dft_pack_format fmt) const
+    {
+        const size_t csize     = size / 2;
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+
+        size_t k = 1;
+        KFR_LOOP_NOUNROLL
+        for (; 2 * (k + width) <= csize + 1; k += width)
+        {
+            const cvec<T, width> fpk   = cread<width>(out + k);
+            const cvec<T, width> fpnk  = reverse<2>(negodd(cread<width>(out + csize - k - width + 1)));
+            const cvec<T, width> f1k   = (fpk + fpnk) * T(0.5);
+            const cvec<T, width> f2k   = (fpk - fpnk) * T(0.5);
+            const cvec<T, width> t     = cmul(f2k, cread<width>(rtwiddle.data() + k));
+            const cvec<T, width> twf2k = negodd(swap<2>(t));
+            cwrite<width>(out + k, f1k + twf2k);
+            cwrite<width>(out + csize - k - width + 1, reverse<2>(negodd(f1k - twf2k)));
+        }
+        KFR_LOOP_NOUNROLL
+        for (; 2 * k <= csize; k++)
+        {
+            const cvec<T, 1> fpk   = cread<1>(out + k);
+            const cvec<T, 1> fpnk  = negodd(cread<1>(out + csize - k));
+            const cvec<T, 1> f1k   = (fpk + fpnk) * T(0.5);
+            const cvec<T, 1> f2k   = (fpk - fpnk) * T(0.5);
+            const cvec<T, 1> t     = cmul(f2k, cread<1>(rtwiddle.data() + k));
+            const cvec<T, 1> twf2k = negodd(swap<2>(t));
+            cwrite<1>(out + k, f1k + twf2k);
+            if (k != csize - k)
+                cwrite<1>(out + csize - k, negodd(f1k - twf2k));
+        }
+
+        const complex<T> dc = out[0];
+        if (fmt == dft_pack_format::CCs)
+        {
+            out[0]     = complex<T>(dc.real() + dc.imag(), T(0));
+            out[csize] = complex<T>(dc.real() - dc.imag(), T(0));
+        }
+        else
+        {
+            out[0] = complex<T>(dc.real() + dc.imag(), dc.real() - dc.imag());
+        }
+    }
+
+    // Z[k] = (X[k] + conj(X[N/2-k])) + i * conj(W^k) * (X[k] - conj(X[N/2-k]))
+    void from_fmt(complex<T>* out, const complex<T>* in, dft_pack_format fmt) const
+    {
+        const size_t csize     = size / 2;
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+
+        complex<T> dc;
+        if (fmt == dft_pack_format::CCs)
+            dc = complex<T>(in[0].real() + in[csize].real(), in[0].real() - in[csize].real());
+        else
+            dc = complex<T>(in[0].real() + in[0].imag(), in[0].real() - in[0].imag());
+
+        size_t k = 1;
+        KFR_LOOP_NOUNROLL
+        for (; 2 * (k + width) <= csize + 1; k += width)
+        {
+            const cvec<T, width> fpk   = cread<width>(in + k);
+            const cvec<T, width> fpnk  = reverse<2>(negodd(cread<width>(in + csize - k - width + 1)));
+            const cvec<T, width> f1k   = fpk + fpnk;
+            const cvec<T, width> f2k   = fpk - fpnk;
+            const cvec<T, width> t     = cmul_conj(f2k, cread<width>(rtwiddle.data() + k));
+            const cvec<T, width> twf2k = swap<2>(negodd(t));
+            cwrite<width>(out + k, f1k + twf2k);
+            cwrite<width>(out + csize - k - width + 1, reverse<2>(negodd(f1k - twf2k)));
+        }
+        KFR_LOOP_NOUNROLL
+        for (; 2 * k <= csize; k++)
+        {
+            const cvec<T, 1> fpk   = cread<1>(in + k);
+            const cvec<T, 1> fpnk  = negodd(cread<1>(in + csize - k));
+            const cvec<T, 1> f1k   = fpk + fpnk;
+            const cvec<T, 1> f2k   = fpk - fpnk;
+            const cvec<T, 1> t     = cmul_conj(f2k, cread<1>(rtwiddle.data() + k));
+            const cvec<T, 1> twf2k = swap<2>(negodd(t));
+            cwrite<1>(out + k, f1k + twf2k);
+            if (k != csize - k)
+                cwrite<1>(out + csize - k, negodd(f1k - twf2k));
+        }
+        out[0] = dc;
+    }
+
+    // to_fmt over the bit-reversed complex spectrum. Z[k] and Z[N/2-k] are at mirrored positions j
+    // and 3 * lo - 1 - j of each range [lo, 2 * lo), bin N/4 alone at position 1
+    void to_fmt_unordered(complex<T>* out) const
+    {
+        const size_t csize     = size / 2;
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+        const complex<T>* tw   = rtwiddle_unordered.data();
+
+        for (size_t lo = 2; lo < csize; lo *= 2)
+        {
+            const size_t mid = lo + lo / 2;
+            size_t j         = lo;
+            KFR_LOOP_NOUNROLL
+            for (; j + width <= mid; j += width)
+            {
+                const size_t jn            = 3 * lo - j - width;
+                const cvec<T, width> fpk   = cread<width>(out + j);
+                const cvec<T, width> fpnk  = reverse<2>(negodd(cread<width>(out + jn)));
+                const cvec<T, width> f1k   = (fpk + fpnk) * T(0.5);
+                const cvec<T, width> f2k   = (fpk - fpnk) * T(0.5);
+                const cvec<T, width> t     = cmul(f2k, cread<width>(tw + j));
+                const cvec<T, width> twf2k = negodd(swap<2>(t));
+                cwrite<width>(out + j, f1k + twf2k);
+                cwrite<width>(out + jn, reverse<2>(negodd(f1k - twf2k)));
+            }
+            KFR_LOOP_NOUNROLL
+            for (; j < mid; j++)
+            {
+                const size_t jn        = 3 * lo - 1 - j;
+                const cvec<T, 1> fpk   = cread<1>(out + j);
+                const cvec<T, 1> fpnk  = negodd(cread<1>(out + jn));
+                const cvec<T, 1> f1k   = (fpk + fpnk) * T(0.5);
+                const cvec<T, 1> f2k   = (fpk - fpnk) * T(0.5);
+                const cvec<T, 1> t     = cmul(f2k, cread<1>(tw + j));
+                const cvec<T, 1> twf2k = negodd(swap<2>(t));
+                cwrite<1>(out + j, f1k + twf2k);
+                cwrite<1>(out + jn, negodd(f1k - twf2k));
+            }
+        }
+        {
+            const cvec<T, 1> fpk   = cread<1>(out + 1);
+            const cvec<T, 1> fpnk  = negodd(fpk);
+            const cvec<T, 1> t     = cmul((fpk - fpnk) * T(0.5), cread<1>(tw + 1));
+            cwrite<1>(out + 1, (fpk + fpnk) * T(0.5) + negodd(swap<2>(t)));
+        }
+
+        const complex<T> dc = out[0];
+        out[0]              = complex<T>(dc.real() + dc.imag(), T(0));
+        out[csize]          = complex<T>(dc.real() - dc.imag(), T(0));
+    }
+
+    // from_fmt with the positions of to_fmt_unordered
+    void from_fmt_unordered(complex<T>* out, const complex<T>* in) const
+    {
+        const size_t csize     = size / 2;
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+        const complex<T>* tw   = rtwiddle_unordered.data();
+
+        const complex<T> dc = complex<T>(in[0].real() + in[csize].real(), in[0].real() - in[csize].real());
+        for (size_t lo = 2; lo < csize; lo *= 2)
+        {
+            const size_t mid = lo + lo / 2;
+            size_t j         = lo;
+            KFR_LOOP_NOUNROLL
+            for (; j + width <= mid; j += width)
+            {
+                const size_t jn            = 3 * lo - j - width;
+                const cvec<T, width> fpk   = cread<width>(in + j);
+                const cvec<T, width> fpnk  = reverse<2>(negodd(cread<width>(in + jn)));
+                const cvec<T, width> f1k   = fpk + fpnk;
+                const cvec<T, width> f2k   = fpk - fpnk;
+                const cvec<T, width> t     = cmul_conj(f2k, cread<width>(tw + j));
+                const cvec<T, width> twf2k = swap<2>(negodd(t));
+                cwrite<width>(out + j, f1k + twf2k);
+                cwrite<width>(out + jn, reverse<2>(negodd(f1k - twf2k)));
+            }
+            KFR_LOOP_NOUNROLL
+            for (; j < mid; j++)
+            {
+                const size_t jn        = 3 * lo - 1 - j;
+                const cvec<T, 1> fpk   = cread<1>(in + j);
+                const cvec<T, 1> fpnk  = negodd(cread<1>(in + jn));
+                const cvec<T, 1> f1k   = fpk + fpnk;
+                const cvec<T, 1> f2k   = fpk - fpnk;
+                const cvec<T, 1> t     = cmul_conj(f2k, cread<1>(tw + j));
+                const cvec<T, 1> twf2k = swap<2>(negodd(t));
+                cwrite<1>(out + j, f1k + twf2k);
+                cwrite<1>(out + jn, negodd(f1k - twf2k));
+            }
+        }
+        {
+            const cvec<T, 1> fpk  = cread<1>(in + 1);
+            const cvec<T, 1> fpnk = negodd(fpk);
+            const cvec<T, 1> t    = cmul_conj(fpk - fpnk, cread<1>(tw + 1));
+            cwrite<1>(out + 1, fpk + fpnk + swap<2>(negodd(t)));
+        }
+        out[0] = dc;
+    }
+};
+
+namespace internal
+{
+
+// Transforms every line along an axis of length plan.size in place. The array is viewed as
+// outer x plan.size x inner; lines are gathered into rows with a blocked transpose so that the
+// transforms themselves run over contiguous data
+template <typename T, bool inverse>
+void dft_md_axis(cbool_t<inverse>, const dft_plan<T>& plan, complex<T>* data, size_t outer, size_t inner,
+                 u8* temp)
+{
+    const size_t n = plan.size;
+    if (inner == 1)
+    {
+        plan.execute_batch(data, data, temp, outer, 1, n, cbool<inverse>);
+        return;
+    }
+    complex<T>* scratch = ptr_cast<complex<T>>(temp);
+    temp += align_up(sizeof(complex<T>) * n * inner, native_cache_alignment);
+    for (size_t o = 0; o < outer; o++)
+    {
+        complex<T>* block = data + o * n * inner;
+        transpose_rows(scratch, block, n, inner, 0, n);
+        plan.execute_batch(scratch, scratch, temp, inner, 1, n, cbool<inverse>);
+        transpose_rows(block, scratch, inner, n, 0, inner);
+    }
+}
+
+template <typename T>
+size_t dft_md_axis_temp_size(const dft_plan<T>& plan, size_t inner)
+{
+    return (inner == 1 ? 0 : align_up(sizeof(complex<T>) * plan.size * inner, native_cache_alignment)) +
+           plan.batch_temp_size();
+}
+}
+
+/// Multidimensional complex transform. shape lists dimensions from the outermost to the
+/// innermost (contiguous) one. As for dft_plan, the inverse transform is unnormalized
+template <typename T>
+struct dft_plan_md
+{
+    std::vector<size_t> shape;
+    size_t size;
+    size_t temp_size;
+
+    template <bool direct = true, bool inverse = true>
+    dft_plan_md(const std::vector<size_t>& shape, cbools_t<direct, inverse> type = dft_type::both)
+        : shape(shape), size(1), temp_size(0)
+    {
+        for (size_t n : shape)
+            size *= n;
+        size_t inner = 1;
+        plans.resize(shape.size());
+        for (size_t d = shape.size(); d-- > 0;)
+        {
+            if (shape[d] > 1)
+            {
+                plans[d].reset(new dft_plan<T>(shape[d], type));
+                plans[d]->enable_batch();
+                temp_size = std::max(temp_size, internal::dft_md_axis_temp_size(*plans[d], inner));
+            }
+            inner *= shape[d];
+        }
+    }
+
+    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, bool inverse = false) const
+    {
+        if (inverse)
+            execute_md(ctrue, out, in, temp);
+        else
+            execute_md(cfalse, out, in, temp);
+    }
+    template <bool inverse>
+    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, cbool_t<inverse> inv) const
+    {
+        execute_md(inv, out, in, temp);
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<complex<T>, Tag2>& in,
+                            univector<u8, Tag3>& temp, bool inverse = false) const
+    {
+        execute(out.data(), in.data(), temp.data(), inverse);
+    }
+
+private:
+    std::vector<std::unique_ptr<dft_plan<T>>> plans;
+
+    template <bool inverse>
+    void execute_md(cbool_t<inverse>, complex<T>* out, const complex<T>* in, u8* temp) const
+    {
+        if (out != in)
+            builtin_memcpy(out, in, sizeof(complex<T>) * size);
+        size_t inner = 1;
+        for (size_t d = shape.size(); d-- > 0;)
+        {
+            if (plans[d])
+                internal::dft_md_axis(cbool<inverse>, *plans[d], out, size / (inner * shape[d]), inner, temp);
+            inner *= shape[d];
+        }
+    }
+};
+
+/// Multidimensional real transform. The innermost dimension must be even; the spectrum has
+/// the same shape except for the innermost dimension which is shape.back() / 2 + 1 (CCs layout)
+template <typename T>
+struct dft_plan_md_real
+{
+    std::vector<size_t> shape;
+    size_t size;
+    size_t complex_size;
+    size_t temp_size;
+
+    template <bool direct = true, bool inverse = true>
+    dft_plan_md_real(const std::vector<size_t>& shape, cbools_t<direct, inverse> type = dft_type::both)
+        : shape(shape), size(1), complex_size(1), temp_size(0), real_plan(shape.back(), type)
+    {
+        for (size_t n : shape)
+            size *= n;
+        rows         = size / shape.back();
+        half         = shape.back() / 2 + 1;
+        complex_size = rows * half;
+        temp_size    = real_plan.temp_size;
+        size_t inner = half;
+        plans.resize(shape.size() - 1);
+        for (size_t d = shape.size() - 1; d-- > 0;)
+        {
+            if (shape[d] > 1)
+            {
+                plans[d].reset(new dft_plan<T>(shape[d], type));
+                plans[d]->enable_batch();
+                temp_size = std::max(temp_size, internal::dft_md_axis_temp_size(*plans[d], inner));
+            }
+            inner *= shape[d];
+        }
+        // the inverse transform keeps the input intact and works on a copy
+        temp_size += align_up(sizeof(complex<T>) * complex_size, native_cache_alignment);
+    }
+
+    KFR_INTRIN void execute(complex<T>* out, const T* in, u8* temp) const
+    {
+        for (size_t r = 0; r < rows; r++)
+            real_plan.execute(out + r * half, in + r * shape.back(), temp);
+        axes(cfalse, out, temp);
+    }
+    KFR_INTRIN void execute(T* out, const complex<T>* in, u8* temp) const
+    {
+        complex<T>* copy = ptr_cast<complex<T>>(temp);
+        temp += align_up(sizeof(complex<T>) * complex_size, native_cache_alignment);
+        builtin_memcpy(copy, in, sizeof(complex<T>) * complex_size);
+        axes(ctrue, copy, temp);
+        for (size_t r = 0; r < rows; r++)
+            real_plan.execute(out + r * shape.back(), copy + r * half, temp);
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<T, Tag2>& in,
+                            univector<u8, Tag3>& temp) const
+    {
+        execute(out.data(), in.data(), temp.data());
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<T, Tag1>& out, const univector<complex<T>, Tag2>& in,
+                            univector<u8, Tag3>& temp) const
+    {
+        execute(out.data(), in.data(), temp.data());
+    }
+
+private:
+    dft_plan_real<T> real_plan;
+    std::vector<std::unique_ptr<dft_plan<T>>> plans;
+    size_t rows;
+    size_t half;
+
+    template <bool inverse>
+    void axes(cbool_t<inverse>, complex<T>* data, u8* temp) const
+    {
+        size_t inner = half;
+        for (size_t d = shape.size() - 1; d-- > 0;)
+        {
+            if (plans[d])
+                internal::dft_md_axis(cbool<inverse>, *plans[d], data, complex_size / (inner * shape[d]),
+                                      inner, temp);
+            inner *= shape[d];
+        }
+    }
 };
 }
 
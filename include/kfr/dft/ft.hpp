@@ -72,7 +72,7 @@ KFR_FN(cmul)
 template <typename T, size_t N, KFR_ENABLE_IF(N >= 2)>
 KFR_INLINE vec<T, N> cmul_conj(vec<T, N> x, vec<T, N> y)
 {
-    return swap<2>(subadd(swap<2>(x) * cdupreal(y), x * cdupimag(y)));
+    return swap<2>(subadd(swap<2>(x) * dupeven(y), x * dupodd(y)));
 }
 template <typename T, size_t N, KFR_ENABLE_IF(N >= 2)>
 KFR_INLINE vec<T, N> cmul_2conj(vec<T, N> in0, vec<T, N> in1, vec<T, N> tw)
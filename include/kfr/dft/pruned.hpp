@@ -0,0 +1,184 @@
+/**
+ * Copyright (C) 2016 D Levin (http://www.kfrlib.com)
+ * This file is part of KFR
+ *
+ * KFR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFR is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KFR.
+ *
+ * If GPL is not suitable for your project, you must purchase a commercial license to use KFR.
+ * Buying a commercial license is mandatory as soon as you develop commercial activities without
+ * disclosing the source code of your own applications.
+ * See http://www.kfrlib.com for details.
+ */
+#pragma once
+
+#include "fft.hpp"
+
+namespace kfr
+{
+
+namespace internal
+{
+// Smallest divisor of size that is not less than count
+inline size_t pruned_dft_subsize(size_t size, size_t count)
+{
+    for (size_t m = std::max(count, size_t(1)); m < size; m++)
+        if (size % m == 0)
+            return m;
+    return size;
+}
+}
+
+/// Complex transform of size points of which only the first input_size may be nonzero, the rest
+/// are not read. With size = P * M, M >= input_size, the bins P*k + q are the M-point transform of
+/// the input rotated by exp(-2 pi i n q / size), so the P transforms of size M replace the full
+/// transform and the butterflies over the zero padding are skipped. input_size is clamped to size.
+/// The inverse transform is unnormalized
+template <typename T>
+struct dft_plan_pruned_input
+{
+    size_t size;
+    size_t input_size;
+    size_t temp_size;
+
+    dft_plan_pruned_input(size_t size, size_t input_size)
+        : size(size), input_size(std::min(input_size, size)), temp_size(0),
+          plan(internal::pruned_dft_subsize(size, this->input_size)), stride(size / plan.size),
+          twiddle(this->input_size * stride)
+    {
+        for (size_t n = 0; n < this->input_size; n++)
+            for (size_t q = 0; q < stride; q++)
+            {
+                const cvec<T, 1> tw     = calculate_twiddle<T>(n * q, size);
+                twiddle[n * stride + q] = complex<T>(tw[0], tw[1]);
+            }
+        plan.enable_batch();
+        temp_size = align_up(sizeof(complex<T>) * size, native_cache_alignment) + plan.batch_temp_size();
+    }
+
+    /// Reads input_size values from in and writes size values to out
+    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, bool inverse = false) const
+    {
+        if (inverse)
+            execute(out, in, temp, ctrue);
+        else
+            execute(out, in, temp, cfalse);
+    }
+    template <bool inverse>
+    void execute(complex<T>* out, const complex<T>* in, u8* temp, cbool_t<inverse>) const
+    {
+        // rotated inputs interleaved as rotated[n * stride + q], so the strided batch leaves bin
+        // P*k + q at out[k * stride + q]
+        complex<T>* rotated = ptr_cast<complex<T>>(temp);
+        for (size_t n = 0; n < input_size; n++)
+        {
+            const cvec<T, 1> x   = cread<1>(in + n);
+            const complex<T>* tw = twiddle.data() + n * stride;
+            for (size_t q = 0; q < stride; q++)
+                cwrite<1>(rotated + n * stride + q,
+                          inverse ? cmul_conj(x, cread<1>(tw + q)) : cmul(x, cread<1>(tw + q)));
+        }
+        builtin_memset(rotated + input_size * stride, 0, sizeof(complex<T>) * (size - input_size * stride));
+        plan.execute_batch(out, rotated, temp + align_up(sizeof(complex<T>) * size, native_cache_alignment),
+                           stride, stride, 1, cbool<inverse>);
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<complex<T>, Tag2>& in,
+                            univector<u8, Tag3>& temp, bool inverse = false) const
+    {
+        execute(out.data(), in.data(), temp.data(), inverse);
+    }
+
+private:
+    dft_plan<T> plan;
+    size_t stride;
+    univector<complex<T>> twiddle;
+};
+
+/// Complex transform of size points that only computes the count bins starting from first. With
+/// size = P * M, M >= count, the input is split into P decimated sequences x[P*m + p] which are
+/// transformed with M points each, then every requested bin k combines the P values at k mod M
+/// with the twiddles exp(-2 pi i p k / size). Costs size * log(M) + count * P instead of
+/// size * log(size). count is clamped to size. The inverse transform is unnormalized
+template <typename T>
+struct dft_plan_pruned_output
+{
+    size_t size;
+    size_t first;
+    size_t count;
+    size_t temp_size;
+
+    dft_plan_pruned_output(size_t size, size_t first, size_t count)
+        : size(size), first(first), count(std::min(count, size)), temp_size(0),
+          plan(internal::pruned_dft_subsize(size, this->count)), stride(size / plan.size),
+          twiddle(this->count * stride)
+    {
+        for (size_t k = 0; k < this->count; k++)
+            for (size_t p = 0; p < stride; p++)
+            {
+                const cvec<T, 1> tw     = calculate_twiddle<T>(p * ((first + k) % size) % size, size);
+                twiddle[k * stride + p] = complex<T>(tw[0], tw[1]);
+            }
+        plan.enable_batch();
+        temp_size = align_up(sizeof(complex<T>) * size, native_cache_alignment) + plan.batch_temp_size();
+    }
+
+    /// Reads size values from in and writes count values (bins first to first + count - 1) to out
+    KFR_INTRIN void execute(complex<T>* out, const complex<T>* in, u8* temp, bool inverse = false) const
+    {
+        if (inverse)
+            execute(out, in, temp, ctrue);
+        else
+            execute(out, in, temp, cfalse);
+    }
+    template <bool inverse>
+    void execute(complex<T>* out, const complex<T>* in, u8* temp, cbool_t<inverse>) const
+    {
+        constexpr size_t width = vector_width<T, cpu_t::native>;
+        // partial[m * stride + p] is bin m of the transform of x[P*n + p]
+        complex<T>* partial = ptr_cast<complex<T>>(temp);
+        plan.execute_batch(partial, in, temp + align_up(sizeof(complex<T>) * size, native_cache_alignment),
+                           stride, stride, 1, cbool<inverse>);
+        for (size_t k = 0; k < count; k++)
+        {
+            const complex<T>* x  = partial + (first + k) % plan.size * stride;
+            const complex<T>* tw = twiddle.data() + k * stride;
+            cvec<T, width> sum   = 0;
+            size_t p             = 0;
+            KFR_LOOP_NOUNROLL
+            for (; p + width <= stride; p += width)
+                sum += inverse ? cmul_conj(cread<width>(x + p), cread<width>(tw + p))
+                               : cmul(cread<width>(x + p), cread<width>(tw + p));
+            cvec<T, 1> result = 0;
+            KFR_LOOP_NOUNROLL
+            for (; p < stride; p++)
+                result += inverse ? cmul_conj(cread<1>(x + p), cread<1>(tw + p))
+                                  : cmul(cread<1>(x + p), cread<1>(tw + p));
+            for (size_t l = 0; l < width; l++)
+                result += cvec<T, 1>(sum[l * 2], sum[l * 2 + 1]);
+            cwrite<1>(out + k, result);
+        }
+    }
+    template <size_t Tag1, size_t Tag2, size_t Tag3>
+    KFR_INTRIN void execute(univector<complex<T>, Tag1>& out, const univector<complex<T>, Tag2>& in,
+                            univector<u8, Tag3>& temp, bool inverse = false) const
+    {
+        execute(out.data(), in.data(), temp.data(), inverse);
+    }
+
+private:
+    dft_plan<T> plan;
+    size_t stride;
+    univector<complex<T>> twiddle;
+};
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright (C) 2016 D Levin (http://www.kfrlib.com)
+ * This file is part of KFR
+ *
+ * KFR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFR is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KFR.
+ *
+ * If GPL is not suitable for your project, you must purchase a commercial license to use KFR.
+ * Buying a commercial license is mandatory as soon as you develop commercial activities without
+ * disclosing the source code of your own applications.
+ * See http://www.kfrlib.com for details.
+ */
+#pragma once
+
+#include "../expressions/operators.hpp"
+#include "fft.hpp"
+#include <algorithm>
+
+namespace kfr
+{
+
+namespace internal
+{
+// Periodic Hann window, sums to a constant for any hop that divides size / 2
+template <typename T>
+univector<T> stft_default_window(size_t size)
+{
+    univector<T> window(size);
+    for (size_t n = 0; n < size; n++)
+    {
+        const double s = native::sin(c_pi<double> * n / size);
+        window[n]      = static_cast<T>(s * s);
+    }
+    return window;
+}
+}
+
+/// Short-time Fourier transform of a continuous real signal. A frame of size samples ends at every
+/// hop-th input sample, it is multiplied by the analysis window and transformed to size / 2 + 1
+/// bins (dft_pack_format::CCs). The first frame is preceded by size - hop zeros, so each hop
+/// samples of input produce exactly one frame. size must be even and hop must not exceed size
+template <typename T>
+struct stft
+{
+    stft(size_t size, size_t hop) : stft(size, hop, internal::stft_default_window<T>(size)) {}
+    template <size_t Tag>
+    stft(size_t size, size_t hop, const univector<T, Tag>& window)
+        : m_size(size), m_hop(hop), plan(size, dft_type::direct), window(window), frame(size),
+          windowed(size), spectrum(size / 2 + 1), temp(plan.temp_size)
+    {
+        reset();
+    }
+
+    size_t size() const { return m_size; }
+    size_t hop() const { return m_hop; }
+    size_t bins() const { return m_size / 2 + 1; }
+
+    /// Appends count samples of input, fn(const complex<T>* spectrum) is called for each completed
+    /// frame. Returns the number of frames
+    template <typename Fn>
+    size_t process(const T* input, size_t count, Fn&& fn)
+    {
+        size_t frames = 0;
+        while (count)
+        {
+            const size_t part = std::min(count, m_size - filled);
+            builtin_memcpy(frame.data() + filled, input, sizeof(T) * part);
+            filled += part;
+            input += part;
+            count -= part;
+            if (filled == m_size)
+            {
+                windowed = frame * window;
+                plan.execute(spectrum.data(), windowed.data(), temp.data());
+                fn(static_cast<const complex<T>*>(spectrum.data()));
+                std::copy(frame.data() + m_hop, frame.data() + m_size, frame.data());
+                filled = m_size - m_hop;
+                frames++;
+            }
+        }
+        return frames;
+    }
+    template <size_t Tag, typename Fn>
+    size_t process(const univector<T, Tag>& input, Fn&& fn)
+    {
+        return process(input.data(), input.size(), std::forward<Fn>(fn));
+    }
+
+    void reset()
+    {
+        frame  = scalar(T(0));
+        filled = m_size - m_hop;
+    }
+
+private:
+    size_t m_size;
+    size_t m_hop;
+    size_t filled;
+    dft_plan_real<T> plan;
+    univector<T> window;
+    univector<T> frame;
+    univector<T> windowed;
+    univector<complex<T>> spectrum;
+    univector<u8> temp;
+};
+
+/// Inverse of stft: each frame of size / 2 + 1 bins is transformed back, multiplied by the
+/// synthesis window and overlap-added, then hop finished samples are written to the output.
+/// The synthesis window is the dual of the analysis window (w[n] / sum w[n + k*hop]^2), so that
+/// istft(stft(x)) reproduces x delayed by size - hop samples for any window whose shifted squares
+/// don't vanish anywhere
+template <typename T>
+struct istft
+{
+    istft(size_t size, size_t hop) : istft(size, hop, internal::stft_default_window<T>(size)) {}
+    template <size_t Tag>
+    istft(size_t size, size_t hop, const univector<T, Tag>& window)
+        : m_size(size), m_hop(hop), plan(size, dft_type::inverse), synthesis(size), frame(size),
+          accumulator(size), temp(plan.temp_size)
+    {
+        for (size_t n = 0; n < size; n++)
+        {
+            T sum = 0;
+            for (size_t k = n % hop; k < size; k += hop)
+                sum += window[k] * window[k];
+            // the inverse transform is unnormalized, 1 / size is folded into the window
+            synthesis[n] = sum == 0 ? T(0) : window[n] / (sum * size);
+        }
+        reset();
+    }
+
+    size_t size() const { return m_size; }
+    size_t hop() const { return m_hop; }
+    size_t bins() const { return m_size / 2 + 1; }
+
+    /// Adds one frame of bins() values and writes hop() samples of output
+    void process(T* output, const complex<T>* spectrum)
+    {
+        plan.execute(frame.data(), spectrum, temp.data());
+        accumulator = accumulator + frame * synthesis;
+        builtin_memcpy(output, accumulator.data(), sizeof(T) * m_hop);
+        std::copy(accumulator.data() + m_hop, accumulator.data() + m_size, accumulator.data());
+        accumulator.slice(m_size - m_hop) = scalar(T(0));
+    }
+
+    void reset() { accumulator = scalar(T(0)); }
+
+private:
+    size_t m_size;
+    size_t m_hop;
+    dft_plan_real<T> plan;
+    univector<T> synthesis;
+    univector<T> frame;
+    univector<T> accumulator;
+    univector<u8> temp;
+};
+}
@@ -23,12 +23,15 @@
 #pragma once
 
 #include "../base/memory.hpp"
+#include "../base/read_write.hpp"
 #include "../base/sin_cos.hpp"
 #include "../base/vec.hpp"
 #include "../expressions/basic.hpp"
 #include "../expressions/operators.hpp"
 #include "../expressions/reduce.hpp"
 #include "window.hpp"
+#include <algorithm>
+#include <limits>
 
 #pragma clang diagnostic push
 #if CID_HAS_WARNING("-Winaccessible-base")
@@ -254,6 +257,498 @@ KFR_INLINE internal::in_fir<>::expression_short_fir<TapCount, T, E1> short_fir(
     return internal::in_fir<>::expression_short_fir<TapCount, T, E1>(std::forward<E1>(e1), taps.ref());
 }
 }
+
+namespace internal
+{
+// out[i] = sum taps[j] * x[i + j] for i < count, x holds count + tapcount - 1 samples. Each pass over
+// the taps accumulates 4 vectors of consecutive outputs, so every tap is broadcast once per
+// 4 * width outputs and the loads are shared between the accumulators
+template <typename T>
+KFR_INTRIN void fir_block(T* out, const T* x, const T* taps, size_t tapcount, size_t count)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    size_t i               = 0;
+    KFR_LOOP_NOUNROLL
+    for (; i + width * 4 <= count; i += width * 4)
+    {
+        vec<T, width> sum0 = T(0), sum1 = T(0), sum2 = T(0), sum3 = T(0);
+        const T* p = x + i;
+        KFR_LOOP_NOUNROLL
+        for (size_t j = 0; j < tapcount; j++, p++)
+        {
+            const vec<T, width> tap = taps[j];
+            sum0 += read<width>(p) * tap;
+            sum1 += read<width>(p + width) * tap;
+            sum2 += read<width>(p + width * 2) * tap;
+            sum3 += read<width>(p + width * 3) * tap;
+        }
+        write(out + i, sum0);
+        write(out + i + width, sum1);
+        write(out + i + width * 2, sum2);
+        write(out + i + width * 3, sum3);
+    }
+    KFR_LOOP_NOUNROLL
+    for (; i + width <= count; i += width)
+    {
+        vec<T, width> sum = T(0);
+        KFR_LOOP_NOUNROLL
+        for (size_t j = 0; j < tapcount; j++)
+            sum += read<width>(x + i + j) * taps[j];
+        write(out + i, sum);
+    }
+    KFR_LOOP_NOUNROLL
+    for (; i < count; i++)
+    {
+        T sum = 0;
+        for (size_t j = 0; j < tapcount; j++)
+            sum += x[i + j] * taps[j];
+        out[i] = sum;
+    }
+}
+
+// Linear-phase variant of fir_block for taps[j] = taps[N-1-j] (or -taps[N-1-j] if antisymmetric):
+// the mirrored samples are added (subtracted) first, so only the first N / 2 taps are multiplied.
+// The middle tap of an odd symmetric filter is applied separately
+template <bool antisymmetric, typename T>
+KFR_INTRIN void fir_block_symmetric(T* out, const T* x, const T* taps, size_t tapcount, size_t count)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    const size_t half      = tapcount / 2;
+    const bool middle      = !antisymmetric && tapcount % 2 == 1;
+    const size_t last      = tapcount - 1;
+    auto fold = [](auto a, auto b) { return antisymmetric ? a - b : a + b; };
+    size_t i  = 0;
+    KFR_LOOP_NOUNROLL
+    for (; i + width * 4 <= count; i += width * 4)
+    {
+        vec<T, width> sum0 = T(0), sum1 = T(0), sum2 = T(0), sum3 = T(0);
+        if (middle)
+        {
+            const vec<T, width> tap = taps[half];
+            sum0                    = read<width>(x + i + half) * tap;
+            sum1                    = read<width>(x + i + half + width) * tap;
+            sum2                    = read<width>(x + i + half + width * 2) * tap;
+            sum3                    = read<width>(x + i + half + width * 3) * tap;
+        }
+        const T* p = x + i;
+        const T* q = x + i + last;
+        KFR_LOOP_NOUNROLL
+        for (size_t j = 0; j < half; j++, p++, q--)
+        {
+            const vec<T, width> tap = taps[j];
+            sum0 += fold(read<width>(p), read<width>(q)) * tap;
+            sum1 += fold(read<width>(p + width), read<width>(q + width)) * tap;
+            sum2 += fold(read<width>(p + width * 2), read<width>(q + width * 2)) * tap;
+            sum3 += fold(read<width>(p + width * 3), read<width>(q + width * 3)) * tap;
+        }
+        write(out + i, sum0);
+        write(out + i + width, sum1);
+        write(out + i + width * 2, sum2);
+        write(out + i + width * 3, sum3);
+    }
+    KFR_LOOP_NOUNROLL
+    for (; i + width <= count; i += width)
+    {
+        vec<T, width> sum = middle ? read<width>(x + i + half) * taps[half] : vec<T, width>(T(0));
+        KFR_LOOP_NOUNROLL
+        for (size_t j = 0; j < half; j++)
+            sum += fold(read<width>(x + i + j), read<width>(x + i + last - j)) * taps[j];
+        write(out + i, sum);
+    }
+    KFR_LOOP_NOUNROLL
+    for (; i < count; i++)
+    {
+        T sum = middle ? x[i + half] * taps[half] : T(0);
+        for (size_t j = 0; j < half; j++)
+            sum += fold(x[i + j], x[i + last - j]) * taps[j];
+        out[i] = sum;
+    }
+}
+
+// out[i * stride + c] = sum taps[j] * x[(i + j) * stride + c] for i < count and c < stride, where
+// stride is a multiple of the vector width and x is aligned. Every channel is a SIMD lane and each
+// tap is broadcast once per 4 vectors of channels
+template <typename T>
+KFR_INTRIN void fir_bank_block(T* out, const T* x, const T* taps, size_t tapcount, size_t stride,
+                               size_t count)
+{
+    constexpr size_t width = vector_width<T, cpu_t::native>;
+    KFR_LOOP_NOUNROLL
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t c = 0;
+        KFR_LOOP_NOUNROLL
+        for (; c + width * 4 <= stride; c += width * 4)
+        {
+            vec<T, width> sum0 = T(0), sum1 = T(0), sum2 = T(0), sum3 = T(0);
+            const T* p = x + i * stride + c;
+            KFR_LOOP_NOUNROLL
+            for (size_t j = 0; j < tapcount; j++, p += stride)
+            {
+                const vec<T, width> tap = taps[j];
+                sum0 += read<width, true>(p) * tap;
+                sum1 += read<width, true>(p + width) * tap;
+                sum2 += read<width, true>(p + width * 2) * tap;
+                sum3 += read<width, true>(p + width * 3) * tap;
+            }
+            write<true>(out + i * stride + c, sum0);
+            write<true>(out + i * stride + c + width, sum1);
+            write<true>(out + i * stride + c + width * 2, sum2);
+            write<true>(out + i * stride + c + width * 3, sum3);
+        }
+        KFR_LOOP_NOUNROLL
+        for (; c < stride; c += width)
+        {
+            vec<T, width> sum = T(0);
+            const T* p        = x + i * stride + c;
+            KFR_LOOP_NOUNROLL
+            for (size_t j = 0; j < tapcount; j++, p += stride)
+                sum += read<width, true>(p) * taps[j];
+            write<true>(out + i * stride + c, sum);
+        }
+    }
+}
+}
+
+/// Interface of stateful filters processing blocks of samples
+template <typename T>
+struct filter
+{
+    virtual ~filter() {}
+
+    /// Filters count samples, in and out may point to the same buffer
+    virtual void process(T* out, const T* in, size_t count) = 0;
+
+    /// Clears the state
+    virtual void reset() = 0;
+
+    template <size_t Tag1, size_t Tag2>
+    void process(univector<T, Tag1>& out, const univector<T, Tag2>& in)
+    {
+        process(out.data(), in.data(), in.size());
+    }
+};
+
+enum class fir_symmetry
+{
+    none,
+    symmetric,    // taps[k] == taps[N-1-k], type I and II linear-phase filters
+    antisymmetric // taps[k] == -taps[N-1-k], type III and IV linear-phase filters
+};
+
+/// Detects (anti)symmetric taps, as produced by fir_lowpass, fir_highpass, fir_bandpass and
+/// fir_bandstop. Mirrored taps may differ by a few ulps of the largest tap, which is how far the
+/// window and sinc evaluation of the two halves may round differently
+template <typename T>
+fir_symmetry detect_fir_symmetry(const T* taps, size_t size)
+{
+    T largest = 0;
+    for (size_t k = 0; k < size; k++)
+        largest = std::max(largest, taps[k] < 0 ? -taps[k] : taps[k]);
+    const T tolerance  = largest * std::numeric_limits<T>::epsilon() * 4;
+    auto equal         = [tolerance](T a, T b) { return (a > b ? a - b : b - a) <= tolerance; };
+    bool symmetric     = true;
+    bool antisymmetric = true;
+    for (size_t k = 0; k < size - size / 2; k++)
+    {
+        symmetric     = symmetric && equal(taps[k], taps[size - 1 - k]);
+        antisymmetric = antisymmetric && equal(taps[k], -taps[size - 1 - k]);
+    }
+    if (size > 1 && symmetric)
+        return fir_symmetry::symmetric;
+    return size > 1 && antisymmetric ? fir_symmetry::antisymmetric : fir_symmetry::none;
+}
+
+/// Stateful FIR filter processing blocks of samples, with the same output as fir(). The input is
+/// appended to a contiguous history of the last taps.size() - 1 samples, and the outputs are
+/// computed several vectors at a time by internal::fir_block. Symmetric and antisymmetric taps
+/// are detected and filtered by internal::fir_block_symmetric with half the multiplications
+template <typename T>
+struct fir_filter : filter<T>
+{
+    template <size_t Tag>
+    fir_filter(const univector<T, Tag>& taps)
+        : taps(taps.size()), block_size(std::max(size_t(1024), next_poweroftwo(taps.size()))),
+          history(taps.size() - 1 + block_size), taps_symmetry(detect_fir_symmetry(taps.data(), taps.size()))
+    {
+        // reversed, so that output i is the dot product of taps with the history starting at i
+        std::reverse_copy(taps.begin(), taps.end(), this->taps.begin());
+        reset();
+    }
+
+    size_t size() const { return taps.size(); }
+    fir_symmetry symmetry() const { return taps_symmetry; }
+
+    using filter<T>::process;
+
+    void process(T* out, const T* in, size_t count) override
+    {
+        const size_t delay = taps.size() - 1;
+        while (count)
+        {
+            const size_t part = std::min(count, block_size);
+            builtin_memcpy(history.data() + delay, in, sizeof(T) * part);
+            switch (taps_symmetry)
+            {
+            case fir_symmetry::symmetric:
+                internal::fir_block_symmetric<false>(out, history.data(), taps.data(), taps.size(), part);
+                break;
+            case fir_symmetry::antisymmetric:
+                internal::fir_block_symmetric<true>(out, history.data(), taps.data(), taps.size(), part);
+                break;
+            default:
+                internal::fir_block(out, history.data(), taps.data(), taps.size(), part);
+                break;
+            }
+            std::copy(history.data() + part, history.data() + part + delay, history.data());
+            in += part;
+            out += part;
+            count -= part;
+        }
+    }
+
+    void reset() override { history = scalar(T(0)); }
+
+private:
+    univector<T> taps;
+    size_t block_size;
+    univector<T> history;
+    fir_symmetry taps_symmetry;
+};
+
+/// The same FIR filter applied to several channels at once, one channel per SIMD lane. Frames of
+/// all channels are stored together in a history padded to a multiple of the vector width, so each
+/// tap is loaded once per frame for all channels instead of once per channel
+template <typename T>
+struct fir_bank
+{
+    template <size_t Tag>
+    fir_bank(size_t channels, const univector<T, Tag>& taps)
+        : taps(taps.size()), channel_count(channels),
+          stride(align_up(channels, vector_width<T, cpu_t::native>)), block_size(256),
+          history((taps.size() - 1 + block_size) * stride), result(block_size * stride)
+    {
+        std::reverse_copy(taps.begin(), taps.end(), this->taps.begin());
+        reset();
+    }
+
+    size_t channels() const { return channel_count; }
+    size_t size() const { return taps.size(); }
+
+    /// Filters frames of interleaved samples, in and out hold frames * channels() values and may
+    /// point to the same buffer
+    void process_interleaved(T* out, const T* in, size_t frames)
+    {
+        process_frames(frames,
+                       [&](size_t frame, T* dest) {
+                           builtin_memcpy(dest, in + frame * channel_count, sizeof(T) * channel_count);
+                       },
+                       [&](size_t frame, const T* src) {
+                           builtin_memcpy(out + frame * channel_count, src, sizeof(T) * channel_count);
+                       });
+    }
+    template <size_t Tag1, size_t Tag2>
+    void process_interleaved(univector<T, Tag1>& out, const univector<T, Tag2>& in)
+    {
+        process_interleaved(out.data(), in.data(), in.size() / channel_count);
+    }
+
+    /// Filters planar input, in[c] is channel c. All channels must have the same size
+    template <size_t Tag1, size_t Tag2, size_t Tag3, size_t Tag4>
+    void process(univector2d<T, Tag1, Tag2>& out, const univector2d<T, Tag3, Tag4>& in)
+    {
+        process_frames(in[0].size(),
+                       [&](size_t frame, T* dest) {
+                           for (size_t c = 0; c < channel_count; c++)
+                               dest[c] = in[c][frame];
+                       },
+                       [&](size_t frame, const T* src) {
+                           for (size_t c = 0; c < channel_count; c++)
+                               out[c][frame] = src[c];
+                       });
+    }
+
+    void reset() { history = scalar(T(0)); }
+
+private:
+    // load(frame, dest) writes the channels of an input frame, store(frame, src) reads the output
+    template <typename Load, typename Store>
+    void process_frames(size_t frames, Load&& load, Store&& store)
+    {
+        const size_t delay = (taps.size() - 1) * stride;
+        for (size_t done = 0; done < frames;)
+        {
+            const size_t part = std::min(frames - done, block_size);
+            for (size_t i = 0; i < part; i++)
+                load(done + i, history.data() + delay + i * stride);
+            internal::fir_bank_block(result.data(), history.data(), taps.data(), taps.size(), stride, part);
+            for (size_t i = 0; i < part; i++)
+                store(done + i, result.data() + i * stride);
+            std::copy(history.data() + part * stride, history.data() + part * stride + delay, history.data());
+            done += part;
+        }
+    }
+
+    univector<T> taps;
+    size_t channel_count;
+    size_t stride;
+    size_t block_size;
+    univector<T> history;
+    univector<T> result;
+};
+
+namespace internal
+{
+// Taps of phase p of a polyphase filter with the given number of phases, reversed for fir_block:
+// phase p holds taps[j * phases + p] at index length - 1 - j, zero past the end of taps
+template <typename T, size_t Tag>
+univector<T> polyphase_taps(const univector<T, Tag>& taps, size_t phases)
+{
+    const size_t length = (taps.size() + phases - 1) / phases;
+    univector<T> result(length * phases, T(0));
+    for (size_t k = 0; k < taps.size(); k++)
+        result[k % phases * length + length - 1 - k / phases] = taps[k];
+    return result;
+}
+}
+
+/// Decimating FIR filter: y[m] = sum taps[k] * x[m * factor - k], the same as fir() followed by
+/// keeping every factor-th sample starting from the first one. The taps are split into factor
+/// phases, phase p filters the input samples x[n * factor - p] at the output rate, so the cost
+/// per output is taps.size() multiplications rather than per input
+template <typename T>
+struct fir_decimator
+{
+    template <size_t Tag>
+    fir_decimator(size_t factor, const univector<T, Tag>& taps)
+        : factor(factor), length((taps.size() + factor - 1) / factor), block_size(256),
+          phase_taps(internal::polyphase_taps(taps, factor)), history(factor * (length + block_size)),
+          phase_output(block_size)
+    {
+        reset();
+    }
+
+    /// Filters count samples and writes one output per factor inputs to out, returns the number of
+    /// outputs written. out may point to the input buffer
+    size_t process(T* out, const T* in, size_t count)
+    {
+        const size_t stride = length + block_size;
+        size_t outputs      = 0;
+        while (count)
+        {
+            // sample q of a frame of factor inputs is sample n of phase factor - 1 - q
+            for (; count && frames < block_size; in++, count--)
+            {
+                history[(factor - 1 - filled) * stride + length - 1 + frames] = *in;
+                if (++filled == factor)
+                {
+                    filled = 0;
+                    frames++;
+                }
+            }
+            if (frames == block_size || (frames && !count))
+            {
+                flush(out + outputs);
+                outputs += frames;
+                frames = 0;
+            }
+        }
+        return outputs;
+    }
+    template <size_t Tag1, size_t Tag2>
+    size_t process(univector<T, Tag1>& out, const univector<T, Tag2>& in)
+    {
+        return process(out.data(), in.data(), in.size());
+    }
+
+    /// Clears the history, the next input is the first sample of a frame
+    void reset()
+    {
+        history = scalar(T(0));
+        // the first frame is preceded by factor - 1 zeros, so that input 0 gives output 0
+        filled = factor - 1;
+        frames = 0;
+    }
+
+private:
+    void flush(T* out)
+    {
+        const size_t stride = length + block_size;
+        for (size_t p = 0; p < factor; p++)
+        {
+            T* phase_history = history.data() + p * stride;
+            internal::fir_block(p ? phase_output.data() : out, phase_history, phase_taps.data() + p * length,
+                                length, frames);
+            if (p)
+                make_univector(out, frames) = make_univector(out, frames) + phase_output.slice(0, frames);
+            // the slot after the last frame may hold a partial frame
+            std::copy(phase_history + frames, phase_history + frames + length, phase_history);
+        }
+    }
+
+    size_t factor;
+    size_t length;
+    size_t block_size;
+    univector<T> phase_taps;
+    univector<T> history;
+    univector<T> phase_output;
+    size_t filled;
+    size_t frames;
+};
+
+/// Interpolating FIR filter: the same as fir() applied to the input with factor - 1 zeros inserted
+/// after every sample. Output sample n * factor + r is produced by phase r of the taps,
+/// taps[j * factor + r], applied to the input at the input rate, so the zeros are never
+/// multiplied. For unity gain the taps must sum to factor
+template <typename T>
+struct fir_interpolator
+{
+    template <size_t Tag>
+    fir_interpolator(size_t factor, const univector<T, Tag>& taps)
+        : factor(factor), length((taps.size() + factor - 1) / factor), block_size(256),
+          phase_taps(internal::polyphase_taps(taps, factor)), history(length - 1 + block_size),
+          phase_output(block_size)
+    {
+        reset();
+    }
+
+    /// Filters count samples and writes count * factor outputs to out
+    void process(T* out, const T* in, size_t count)
+    {
+        const size_t delay = length - 1;
+        while (count)
+        {
+            const size_t part = std::min(count, block_size);
+            builtin_memcpy(history.data() + delay, in, sizeof(T) * part);
+            for (size_t r = 0; r < factor; r++)
+            {
+                internal::fir_block(phase_output.data(), history.data(), phase_taps.data() + r * length,
+                                    length, part);
+                for (size_t i = 0; i < part; i++)
+                    out[i * factor + r] = phase_output[i];
+            }
+            std::copy(history.data() + part, history.data() + part + delay, history.data());
+            in += part;
+            out += part * factor;
+            count -= part;
+        }
+    }
+    template <size_t Tag1, size_t Tag2>
+    void process(univector<T, Tag1>& out, const univector<T, Tag2>& in)
+    {
+        process(out.data(), in.data(), in.size());
+    }
+
+    void reset() { history = scalar(T(0)); }
+
+private:
+    size_t factor;
+    size_t length;
+    size_t block_size;
+    univector<T> phase_taps;
+    univector<T> history;
+    univector<T> phase_output;
+};
 }
 
 #pragma clang diagnostic pop
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2016 D Levin (http://www.kfrlib.com)
+ * This file is part of KFR
+ *
+ * KFR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFR is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KFR.
+ *
+ * If GPL is not suitable for your project, you must purchase a commercial license to use KFR.
+ * Buying a commercial license is mandatory as soon as you develop commercial activities without
+ * disclosing the source code of your own applications.
+ * See http://www.kfrlib.com for details.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kfr
+{
+
+/// Fixed set of worker threads running indexed jobs. The calling thread takes part in each job
+struct thread_pool
+{
+    explicit thread_pool(size_t threads = std::thread::hardware_concurrency())
+    {
+        for (size_t i = 1; i < threads; i++)
+            workers.emplace_back([this]() { worker(); });
+    }
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start.notify_all();
+        for (std::thread& thread : workers)
+            thread.join();
+    }
+
+    size_t size() const { return workers.size() + 1; }
+
+    /// Calls fn(index) for each index in [0, count) and waits for all calls to complete
+    template <typename Fn>
+    void parallel_for(size_t count, Fn&& fn)
+    {
+        if (workers.empty() || count <= 1)
+        {
+            for (size_t index = 0; index < count; index++)
+                fn(index);
+            return;
+        }
+        std::lock_guard<std::mutex> serial(run_mutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job        = [&fn](size_t index) { fn(index); };
+            job_count  = count;
+            next_index = 0;
+            busy       = workers.size();
+            generation++;
+        }
+        start.notify_all();
+        run_job();
+        std::unique_lock<std::mutex> lock(mutex);
+        finish.wait(lock, [this]() { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    void run_job()
+    {
+        for (size_t index = next_index++; index < job_count; index = next_index++)
+            job(index);
+    }
+    void worker()
+    {
+        size_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+            run_job();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busy == 0)
+                    finish.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex run_mutex;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable finish;
+    std::function<void(size_t)> job;
+    std::atomic<size_t> next_index{ 0 };
+    size_t job_count  = 0;
+    size_t busy       = 0;
+    size_t generation = 0;
+    bool stopping     = false;
+};
+}
@@ -47,9 +47,14 @@ set(
     ${PROJECT_SOURCE_DIR}/include/kfr/data/bitrev.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/data/sincos.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/dft/bitrev.hpp
+    ${PROJECT_SOURCE_DIR}/include/kfr/dft/cache.hpp
+    ${PROJECT_SOURCE_DIR}/include/kfr/dft/czt.hpp
+    ${PROJECT_SOURCE_DIR}/include/kfr/dft/dct.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/dft/fft.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/dft/ft.hpp
+    ${PROJECT_SOURCE_DIR}/include/kfr/dft/pruned.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/dft/reference_dft.hpp
+    ${PROJECT_SOURCE_DIR}/include/kfr/dft/stft.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/dft/conv.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/dispatch/cpuid.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/dispatch/runtimedispatch.hpp
@@ -78,6 +83,7 @@ set(
     ${PROJECT_SOURCE_DIR}/include/kfr/misc/compiletime.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/misc/random.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/misc/small_buffer.hpp
+    ${PROJECT_SOURCE_DIR}/include/kfr/misc/thread_pool.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/misc/sort.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/vec.hpp
     ${PROJECT_SOURCE_DIR}/include/kfr/version.hpp
@@ -8,7 +8,9 @@
 #include <kfr/io/tostring.hpp>
 #include <kfr/version.hpp>
 
+#include <kfr/expressions/basic.hpp>
 #include <kfr/expressions/reduce.hpp>
+#include <kfr/misc/random.hpp>
 
 #include <tuple>
 
@@ -17,6 +19,20 @@
 
 using namespace kfr;
 
+template <typename T>
+static univector<T> reference_convolve(const univector<T>& in, const univector<T>& ir, size_t size)
+{
+    univector<T> out(size);
+    for (size_t n = 0; n < size; n++)
+    {
+        double sum = 0;
+        for (size_t k = n < in.size() ? 0 : n - in.size() + 1; k < std::min(ir.size(), n + 1); k++)
+            sum += double(ir[k]) * double(in[n - k]);
+        out[n] = T(sum);
+    }
+    return out;
+}
+
 TEST(test_convolve)
 {
     univector<double, 5> a({ 1, 2, 3, 4, 5 });
@@ -26,6 +42,211 @@ TEST(test_convolve)
     CHECK(native::rms(c - univector<double>({ 0.25, 1., 2.75, 5., 7.5, 8.5, 7.75, 3.5, 1.25 })) < 0.0001);
 }
 
+TEST(test_correlate)
+{
+    univector<double, 5> a({ 1, 2, 3, 4, 5 });
+    univector<double, 3> b({ 0.25, 0.5, 1.0 });
+    univector<double> c = correlate(a, b);
+    CHECK(c.size() == 7);
+    CHECK(native::rms(c - univector<double>({ 1., 2.5, 4.25, 6., 7.75, 3.5, 1.25 })) < 0.0001);
+
+    univector<double> d = autocorrelate(a);
+    CHECK(d.size() == 5);
+    CHECK(native::rms(d - univector<double>({ 55., 40., 26., 14., 5. })) < 0.0001);
+}
+
+TEST(test_convolve_reuse)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")  = ctypes<float, double>, //
+                  named("size1") = std::make_tuple(1, 15, 100, 1000), //
+                  named("size2") = std::make_tuple(1, 7, 64, 500), //
+                  [&gen](auto type, size_t size1, size_t size2) {
+                      using float_type        = type_of<decltype(type)>;
+                      univector<float_type> a = typed<float_type>(gen_random_range(gen, -1.0, +1.0), size1);
+                      univector<float_type> b = typed<float_type>(gen_random_range(gen, -1.0, +1.0), size2);
+                      univector<float_type> out(size1 + size2 - 1), reversed(size2);
+                      for (size_t i = 0; i < size2; i++)
+                          reversed[i] = b[size2 - 1 - i];
+                      univector<u8> temp(convolve_temp_size<float_type>(size1, size2));
+
+                      const univector<float_type> ref_conv = reference_convolve(a, b, size1 + size2 - 1);
+                      const univector<float_type> ref_corr = reference_convolve(a, reversed, size1 + size2 - 1);
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      using plan_type = internal::dft_plan_real_unordered<float_type>;
+                      dft_cache<float_type, plan_type>& cache = dft_cache<float_type, plan_type>::instance();
+
+                      convolve(out, a, b, temp);
+                      CHECK(native::rms(ref_conv - out) < epsilon * 100 * native::rms(ref_conv));
+
+                      // the second call reuses the cached plan and the same temp
+                      const size_t misses = cache.stats().misses;
+                      correlate(out, a, b, temp);
+                      CHECK(native::rms(ref_corr - out) < epsilon * 100 * native::rms(ref_corr));
+                      CHECK(cache.stats().misses == misses);
+                  });
+}
+
+TEST(test_convolve_methods)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")  = ctypes<float, double>, //
+                  named("size1") = std::make_tuple(1, 33, 1000, 5000), //
+                  named("size2") = std::make_tuple(1, 5, 64, 700), //
+                  [&gen](auto type, size_t size1, size_t size2) {
+                      using float_type        = type_of<decltype(type)>;
+                      univector<float_type> a = typed<float_type>(gen_random_range(gen, -1.0, +1.0), size1);
+                      univector<float_type> b = typed<float_type>(gen_random_range(gen, -1.0, +1.0), size2);
+                      const univector<float_type> ref = reference_convolve(a, b, size1 + size2 - 1);
+                      const double epsilon            = std::numeric_limits<float_type>::epsilon();
+
+                      for (convolve_method method : { convolve_method::automatic, convolve_method::direct,
+                                                      convolve_method::overlap_save, convolve_method::fft })
+                      {
+                          univector<float_type> out(size1 + size2 - 1), lags(size1);
+                          univector<u8> temp(convolve_temp_size<float_type>(size1, size2, method));
+                          convolve(out, a, b, temp, method);
+                          CHECK(native::rms(ref - out) < epsilon * 100 * native::rms(ref));
+
+                          univector<u8> autotemp(convolve_temp_size<float_type>(size1, size1, method));
+                          autocorrelate(lags, a, autotemp, method);
+                          const univector<float_type> ref_lags = autocorrelate(a, convolve_method::direct);
+                          CHECK(native::rms(ref_lags - lags) < epsilon * 100 * native::rms(ref_lags));
+                      }
+                  });
+
+    // empty inputs need no temp and produce nothing
+    for (convolve_method method : { convolve_method::automatic, convolve_method::direct,
+                                    convolve_method::overlap_save, convolve_method::fft })
+    {
+        const univector<float> empty, b({ 1, 2, 3 });
+        CHECK(convolve_temp_size<float>(0, 0, method) == 0);
+        CHECK(convolve_temp_size<float>(0, 3, method) == 0);
+        CHECK(convolve_temp_size<float>(3, 0, method) == 0);
+        CHECK(autocorrelate(empty, method).size() == 0);
+        univector<float> out(2);
+        univector<u8> temp;
+        convolve(out.data(), empty.data(), 0, b.data(), b.size(), temp.data(), method);
+    }
+
+    // a few taps never pay for the transforms, a long kernel always does
+    CHECK(convolve_cost_model<float>::instance().select(100000, 3) == convolve_method::direct);
+    CHECK(convolve_cost_model<float>::instance().select(100000, 4000) != convolve_method::direct);
+    CHECK(convolve_cost_model<double>::instance().select(100000, 3) == convolve_method::direct);
+}
+
+TEST(test_convolver)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")       = ctypes<float, double>, //
+                  named("ir_size")    = std::make_tuple(1, 100, 1000, 1024, 3001), //
+                  named("block_size") = std::make_tuple(16, 64, 256), //
+                  [&gen](auto type, size_t ir_size, size_t block_size) {
+                      using float_type    = type_of<decltype(type)>;
+                      const size_t length = 4000;
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                      univector<float_type> ir =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), ir_size) / float_type(ir_size);
+                      univector<float_type> out(length);
+
+                      convolver<float_type> conv(ir, block_size);
+                      CHECK(conv.latency() == block_size);
+                      const size_t blocks[] = { 1, 7, 64, 333 };
+                      for (size_t position = 0, block = 0; position < length;)
+                      {
+                          const size_t count = std::min(blocks[block++ % 4], length - position);
+                          conv.process(out.data() + position, in.data() + position, count);
+                          position += count;
+                      }
+
+                      const univector<float_type> ref = reference_convolve(in, ir, length - block_size);
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(native::rms(ref - out.slice(block_size)) < epsilon * 100);
+                      CHECK(native::rms(out.slice(0, block_size)) == 0);
+                  });
+}
+
+TEST(test_nonuniform_convolver)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")       = ctypes<float, double>, //
+                  named("ir_size")    = std::make_tuple(50, 500, 5000), //
+                  named("background") = std::make_tuple(false, true), //
+                  [&gen](auto type, size_t ir_size, bool background) {
+                      using float_type        = type_of<decltype(type)>;
+                      const size_t length     = 12000;
+                      const size_t block_size = 16;
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                      univector<float_type> ir =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), ir_size) / float_type(ir_size);
+                      univector<float_type> out(length);
+
+                      // levels of 64, 256 and 1024 samples for the longest impulse response
+                      nonuniform_convolver<float_type> conv(ir, block_size, 1024, background);
+                      CHECK(conv.latency() == block_size);
+                      const size_t blocks[] = { 1, 7, 64, 333 };
+                      for (size_t position = 0, block = 0; position < length;)
+                      {
+                          const size_t count = std::min(blocks[block++ % 4], length - position);
+                          conv.process(out.data() + position, in.data() + position, count);
+                          position += count;
+                      }
+
+                      const univector<float_type> ref = reference_convolve(in, ir, length - block_size);
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(native::rms(ref - out.slice(block_size)) < epsilon * 100);
+                  });
+}
+
+TEST(test_fft_fir_filter)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")       = ctypes<float, double>, //
+                  named("tapcount")   = std::make_tuple(1, 100, 1000, 5000), //
+                  named("block_size") = std::make_tuple(0, 64), //
+                  [&gen](auto type, size_t tapcount, size_t block_size) {
+                      using float_type    = type_of<decltype(type)>;
+                      const size_t length = 12000;
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                      univector<float_type> taps =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), tapcount) / float_type(tapcount);
+                      univector<float_type> ref(length);
+                      ref = native::fir(in, taps);
+
+                      fft_fir_filter<float_type> fft_filter(taps, block_size);
+                      CHECK(fft_filter.size() == tapcount);
+                      univector<float_type> out(length);
+                      const size_t blocks[] = { 1, 13, 64, 2000 };
+                      for (size_t position = 0, block = 0; position < length;)
+                      {
+                          const size_t count = std::min(blocks[block++ % 4], length - position);
+                          fft_filter.process(out.data() + position, in.data() + position, count);
+                          position += count;
+                      }
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(native::rms(ref - out) < epsilon * 100);
+
+                      // whichever filter is chosen, the output is the same
+                      std::unique_ptr<filter<float_type>> automatic = make_fir_filter(taps);
+                      out = in;
+                      automatic->process(out, out);
+                      CHECK(native::rms(ref - out) < epsilon * 100);
+
+                      // mirrored taps are chosen against the symmetric crossover
+                      for (size_t k = 0; k < tapcount / 2; k++)
+                          taps[tapcount - 1 - k] = taps[k];
+                      ref                                           = native::fir(in, taps);
+                      std::unique_ptr<filter<float_type>> symmetric = make_fir_filter(taps);
+                      symmetric->process(out, in);
+                      CHECK(native::rms(ref - out) < epsilon * 100);
+                  });
+}
+
 int main(int argc, char** argv)
 {
     println(library_version());
@@ -11,8 +11,13 @@
 
 #include "testo/testo.hpp"
 #include <kfr/cometa/string.hpp>
+#include <kfr/dft/cache.hpp>
+#include <kfr/dft/czt.hpp>
+#include <kfr/dft/dct.hpp>
 #include <kfr/dft/fft.hpp>
+#include <kfr/dft/pruned.hpp>
 #include <kfr/dft/reference_dft.hpp>
+#include <kfr/dft/stft.hpp>
 #include <kfr/expressions/basic.hpp>
 #include <kfr/expressions/operators.hpp>
 #include <kfr/expressions/reduce.hpp>
@@ -52,6 +57,691 @@ TEST(fft_accuracy)
                   });
 }
 
+TEST(dft_accuracy)
+{
+    testo::active_test()->show_progress = true;
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")    = ctypes<float, double>, //
+                  named("inverse") = std::make_tuple(false, true), //
+                  named("size")    = std::make_tuple(1, 3, 5, 6, 7, 9, 10, 12, 15, 30, 48, 60, 96, 97, 100, 105,
+                                                  120, 143, 210, 480, 635, 960, 1000, 1009, 3000), //
+                  [&gen](auto type, bool inverse, size_t size) {
+                      using float_type = type_of<decltype(type)>;
+
+                      univector<complex<float_type>> in =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                      univector<complex<float_type>> out    = in;
+                      univector<complex<float_type>> refout = out;
+                      const dft_plan<float_type> dft(size);
+                      univector<u8> temp(dft.temp_size);
+
+                      reference_dft(refout.data(), in.data(), size, inverse);
+                      dft.execute(out, out, temp, inverse);
+
+                      const float_type rms_diff = rms(cabs(refout - out));
+                      const double ops          = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon      = std::numeric_limits<float_type>::epsilon();
+                      CHECK(rms_diff < epsilon * ops);
+                  });
+}
+
+TEST(dft_empty)
+{
+    const dft_plan<float> dft(0);
+    CHECK(dft.size == 0);
+    univector<u8> temp(dft.temp_size);
+    // a transform of no points leaves the buffers untouched
+    univector<complex<float>> data(1, complex<float>(1, 2));
+    dft.execute(data.data(), data.data(), temp.data());
+    CHECK(data[0].real() == 1 && data[0].imag() == 2);
+}
+
+TEST(dft_real_accuracy)
+{
+    testo::active_test()->show_progress = true;
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type") = ctypes<float, double>, //
+                  named("size") = std::make_tuple(4, 6, 8, 10, 16, 30, 64, 96, 128, 256, 512, 1000, 1024,
+                                                  2048, 4096, 16384), //
+                  [&gen](auto type, size_t size) {
+                      using float_type = type_of<decltype(type)>;
+                      const size_t csize = size / 2;
+
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), size);
+                      univector<complex<float_type>> cin(size);
+                      for (size_t i = 0; i < size; i++)
+                          cin[i] = complex<float_type>(in[i], float_type(0));
+                      univector<complex<float_type>> refout(size);
+                      reference_dft(refout.data(), cin.data(), size, false);
+
+                      const dft_plan_real<float_type> dft(size);
+                      univector<u8> temp(dft.temp_size);
+
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+
+                      univector<complex<float_type>> out(csize + 1);
+                      dft.execute(out, in, temp, dft_pack_format::CCs);
+                      CHECK(rms(cabs(refout.slice(0, csize + 1) - out)) < epsilon * ops);
+
+                      univector<float_type> back(size);
+                      dft.execute(back, out, temp, dft_pack_format::CCs);
+                      CHECK(rms(back / float_type(size) - in) < epsilon * ops);
+
+                      univector<complex<float_type>> perm(csize);
+                      dft.execute(perm, in, temp, dft_pack_format::Perm);
+                      CHECK(std::abs(perm[0].real() - refout[0].real()) < epsilon * ops * size);
+                      CHECK(std::abs(perm[0].imag() - refout[csize].real()) < epsilon * ops * size);
+                      CHECK(rms(cabs(refout.slice(1, csize - 1) - perm.slice(1, csize - 1))) < epsilon * ops);
+
+                      dft.execute(back, perm, temp, dft_pack_format::Perm);
+                      CHECK(rms(back / float_type(size) - in) < epsilon * ops);
+                  });
+}
+
+TEST(fft_multithreaded)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")    = ctypes<float, double>, //
+                  named("size")    = std::make_tuple(65536, 196608, 262144), //
+                  named("threads") = std::make_tuple(1, 2, 4), //
+                  [&gen](auto type, size_t size, size_t threads) {
+                      using float_type = type_of<decltype(type)>;
+
+                      const dft_plan<float_type> ref(size);
+                      univector<u8> reftemp(ref.temp_size);
+                      dft_plan<float_type> dft(size);
+                      dft.set_threads(threads);
+                      CHECK(dft.threads() == threads);
+                      univector<u8> temp(dft.temp_size);
+
+                      for (bool inverse : { false, true })
+                      {
+                          univector<complex<float_type>> in =
+                              typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                          univector<complex<float_type>> out    = in;
+                          univector<complex<float_type>> refout = in;
+
+                          ref.execute(refout, refout, reftemp, inverse);
+                          dft.execute(out, out, temp, inverse);
+
+                          const float_type rms_diff = rms(cabs(refout - out));
+                          const double ops          = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                          const double epsilon      = std::numeric_limits<float_type>::epsilon();
+                          CHECK(rms_diff < epsilon * ops);
+                      }
+                  });
+}
+
+TEST(fft_batch)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")    = ctypes<float, double>, //
+                  named("inverse") = std::make_tuple(false, true), //
+                  named("size")    = std::make_tuple(4, 8, 32, 256, 512, 2048, 12, 100, 8192), //
+                  [&gen](auto type, bool inverse, size_t size) {
+                      using float_type   = type_of<decltype(type)>;
+                      const size_t count = 13;
+
+                      dft_plan<float_type> dft(size);
+                      const size_t data_size = dft.data_size_bytes();
+                      dft.enable_batch();
+                      CHECK((dft.data_size_bytes() > data_size) == (size <= 4096 && is_poweroftwo(size)));
+                      univector<u8> temp(dft.batch_temp_size());
+                      univector<u8> reftemp(dft.temp_size);
+                      univector<complex<float_type>> refin(size);
+                      univector<complex<float_type>> refout(size);
+                      univector<complex<float_type>> result(size);
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+
+                      for (bool interleaved : { false, true })
+                      {
+                          const size_t stride   = interleaved ? count : 1;
+                          const size_t distance = interleaved ? 1 : size;
+
+                          univector<complex<float_type>> in =
+                              typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * count * 2);
+                          univector<complex<float_type>> out = in;
+                          dft.execute_batch(out.data(), out.data(), temp.data(), count, stride, distance,
+                                            inverse);
+
+                          for (size_t i = 0; i < count; i++)
+                          {
+                              for (size_t n = 0; n < size; n++)
+                              {
+                                  refin[n]  = in[i * distance + n * stride];
+                                  result[n] = out[i * distance + n * stride];
+                              }
+                              dft.execute(refout, refin, reftemp, inverse);
+                              CHECK(rms(cabs(refout - result)) < epsilon * ops);
+                          }
+                      }
+                  });
+}
+
+template <typename T>
+void reference_dft_md(univector<complex<T>>& data, const std::vector<size_t>& shape, bool inverse)
+{
+    size_t inner = 1;
+    for (size_t d = shape.size(); d-- > 0;)
+    {
+        const size_t n     = shape[d];
+        const size_t outer = data.size() / (n * inner);
+        univector<complex<T>> line(n);
+        univector<complex<T>> result(n);
+        for (size_t o = 0; o < outer; o++)
+            for (size_t i = 0; i < inner; i++)
+            {
+                for (size_t k = 0; k < n; k++)
+                    line[k] = data[(o * n + k) * inner + i];
+                reference_dft(result.data(), line.data(), n, inverse);
+                for (size_t k = 0; k < n; k++)
+                    data[(o * n + k) * inner + i] = result[k];
+            }
+        inner *= n;
+    }
+}
+
+TEST(fft_md)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")    = ctypes<float, double>, //
+                  named("inverse") = std::make_tuple(false, true), //
+                  named("shape")   = make_range(0, 5), //
+                  [&gen](auto type, bool inverse, size_t shape_index) {
+                      using float_type                 = type_of<decltype(type)>;
+                      const std::vector<size_t> shapes[] = { { 8, 16 }, { 12, 10 }, { 4, 6, 8 }, { 3, 1, 64 },
+                                                             { 64, 128 } };
+                      const std::vector<size_t>& shape = shapes[shape_index];
+                      const dft_plan_md<float_type> dft(shape);
+
+                      univector<complex<float_type>> in =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), dft.size * 2);
+                      univector<complex<float_type>> out(dft.size);
+                      univector<complex<float_type>> refout = in;
+                      univector<u8> temp(dft.temp_size);
+
+                      dft.execute(out, in, temp, inverse);
+                      reference_dft_md(refout, shape, inverse);
+
+                      const double ops     = (ilog2(next_poweroftwo(dft.size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(rms(cabs(refout - out)) < epsilon * ops);
+                  });
+}
+
+TEST(fft_md_real)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")  = ctypes<float, double>, //
+                  named("shape") = make_range(0, 4), //
+                  [&gen](auto type, size_t shape_index) {
+                      using float_type                   = type_of<decltype(type)>;
+                      const std::vector<size_t> shapes[] = { { 8, 16 }, { 12, 10 }, { 4, 6, 8 }, { 32 } };
+                      const std::vector<size_t>& shape   = shapes[shape_index];
+                      const dft_plan_md_real<float_type> dft(shape);
+                      const size_t n    = shape.back();
+                      const size_t half = n / 2 + 1;
+
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), dft.size);
+                      univector<complex<float_type>> refout(dft.size);
+                      for (size_t i = 0; i < dft.size; i++)
+                          refout[i] = complex<float_type>(in[i], 0);
+                      reference_dft_md(refout, shape, false);
+
+                      univector<complex<float_type>> out(dft.complex_size);
+                      univector<u8> temp(dft.temp_size);
+                      dft.execute(out, in, temp);
+
+                      univector<complex<float_type>> expected(dft.complex_size);
+                      for (size_t r = 0; r < dft.size / n; r++)
+                          for (size_t k = 0; k < half; k++)
+                              expected[r * half + k] = refout[r * n + k];
+
+                      const double ops     = (ilog2(next_poweroftwo(dft.size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(rms(cabs(expected - out)) < epsilon * ops);
+
+                      univector<float_type> back(dft.size);
+                      dft.execute(back, out, temp);
+                      CHECK(rms(back / float_type(dft.size) - in) < epsilon * ops);
+                  });
+}
+
+TEST(dft_cache)
+{
+    dft_cache<float>& cache = dft_cache<float>::instance();
+    cache.clear();
+    cache.reset_stats();
+    cache.set_limits(2, 0);
+
+    const auto plan16 = cached_dft_plan<float>(16);
+    CHECK(plan16 == cached_dft_plan<float>(16));
+    CHECK(plan16 != cached_dft_plan<float>(16, dft_type::direct));
+    CHECK(cache.stats().hits == 1);
+    CHECK(cache.stats().misses == 2);
+    CHECK(cache.stats().plans == 2);
+
+    cached_dft_plan<float>(48);
+    CHECK(cache.stats().plans == 2);
+    CHECK(cache.stats().evictions == 1);
+
+    // the evicted plan is still owned by its users
+    CHECK(plan16->size == 16);
+    CHECK(cached_dft_plan<float>(16) != plan16);
+    CHECK(cache.stats().misses == 4);
+
+    cache.set_limits(64, 0);
+    cache.clear();
+    CHECK(cache.stats().plans == 0);
+    CHECK(cache.stats().memory == 0);
+}
+
+TEST(dft_wisdom)
+{
+    dft_wisdom& wisdom = dft_wisdom::instance();
+    wisdom.clear();
+
+    const dft_config c1024 = dft_measure<float>(1024);
+    const dft_config c60   = dft_measure<double>(60);
+    CHECK(wisdom.contains<float>(1024));
+    CHECK(wisdom.contains<double>(60));
+    CHECK(!wisdom.contains<double>(1024));
+    CHECK(dft_plan<double>(60).config.radix_set == c60.radix_set);
+
+    const char* path = "dft_wisdom_test.txt";
+    CHECK(wisdom.save(path));
+    wisdom.clear();
+    CHECK(!wisdom.contains<float>(1024));
+    CHECK(wisdom.load(path));
+    std::remove(path);
+
+    const dft_config loaded = wisdom.find<float>(1024);
+    CHECK(loaded.algorithm == c1024.algorithm);
+    CHECK(loaded.prefetch == c1024.prefetch);
+    CHECK(loaded.radix_set == c1024.radix_set);
+    CHECK(wisdom.find<double>(60).radix_set == c60.radix_set);
+    wisdom.clear();
+}
+
+TEST(fft_split)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")    = ctypes<float, double>, //
+                  named("inverse") = std::make_tuple(false, true), //
+                  named("size")    = std::make_tuple(16, 256, 1024, 2048, 4096, 65536, 60, 1009), //
+                  [&gen](auto type, bool inverse, size_t size) {
+                      using float_type = type_of<decltype(type)>;
+
+                      univector<complex<float_type>> in =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                      univector<float_type> re(size), im(size), out_re(size), out_im(size);
+                      for (size_t i = 0; i < size; i++)
+                      {
+                          re[i] = in[i].real();
+                          im[i] = in[i].imag();
+                      }
+                      const dft_plan<float_type> dft(size);
+                      univector<complex<float_type>> refout(size);
+                      univector<u8> temp(dft.split_temp_size());
+                      dft.execute(refout, in, temp, inverse);
+                      dft.execute(out_re, out_im, re, im, temp, inverse);
+
+                      univector<complex<float_type>> out(size);
+                      for (size_t i = 0; i < size; i++)
+                          out[i] = complex<float_type>(out_re[i], out_im[i]);
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(rms(cabs(refout - out)) < epsilon * ops);
+                  });
+}
+
+TEST(fft_unordered)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type") = ctypes<float, double>, //
+                  named("size") = std::make_tuple(16, 60, 512, 1024, 2048, 8192), //
+                  [&gen](auto type, size_t size) {
+                      using float_type     = type_of<decltype(type)>;
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+
+                      univector<complex<float_type>> in =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                      univector<complex<float_type>> refout(size), out(size), expected(size);
+                      dft_plan<float_type> dft(size);
+                      dft.enable_unordered();
+                      CHECK(dft.unordered() == (size >= 512 && is_poweroftwo(size)));
+                      univector<u8> temp(dft.temp_size);
+
+                      // bin k at bitreverse(k), or in the natural order if there is no reordering pass
+                      dft.execute(refout, in, temp);
+                      dft.execute_unordered(out.data(), in.data(), temp.data());
+                      for (size_t k = 0; k < size; k++)
+                      {
+                          size_t position = k;
+                          if (dft.unordered())
+                          {
+                              position = 0;
+                              for (size_t bit = 0; bit < ilog2(size); bit++)
+                                  position = (position << 1) | ((k >> bit) & 1);
+                          }
+                          expected[position] = refout[k];
+                      }
+                      CHECK(rms(cabs(expected - out)) < epsilon * ops);
+
+                      // the inverse takes the same order and writes the natural one
+                      univector<complex<float_type>> refback(size);
+                      dft.execute(refback, refout, temp, true);
+                      dft.execute_unordered(out.data(), out.data(), temp.data(), true);
+                      CHECK(rms(cabs(refback - out)) < epsilon * ops * size);
+
+                      // circular convolution of real signals through natural and unordered spectra
+                      univector<float_type> a =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                      univector<float_type> b =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                      dft_plan_real<float_type> rdft(size * 2);
+                      rdft.enable_unordered();
+                      CHECK(rdft.unordered() == dft.unordered());
+                      univector<u8> rtemp(rdft.temp_size);
+                      univector<complex<float_type>> fa(size + 1), fb(size + 1);
+                      univector<float_type> refconv(size * 2), conv(size * 2);
+                      auto multiply = [&]() {
+                          for (size_t i = 0; i <= size; i++)
+                              fa[i] = complex<float_type>(
+                                  fa[i].real() * fb[i].real() - fa[i].imag() * fb[i].imag(),
+                                  fa[i].real() * fb[i].imag() + fa[i].imag() * fb[i].real());
+                      };
+                      rdft.execute(fa, a, rtemp);
+                      rdft.execute(fb, b, rtemp);
+                      multiply();
+                      rdft.execute(refconv, fa, rtemp);
+                      rdft.execute_unordered(fa.data(), a.data(), rtemp.data());
+                      rdft.execute_unordered(fb.data(), b.data(), rtemp.data());
+                      multiply();
+                      rdft.execute_unordered(conv.data(), fa.data(), rtemp.data());
+                      CHECK(rms(refconv - conv) < epsilon * ops * rms(refconv));
+                  });
+}
+
+template <typename T>
+void reference_dct(univector<T>& out, const univector<T>& in, dct_kind kind, bool sine)
+{
+    const size_t size = in.size();
+    const double pi   = c_pi<double>;
+    for (size_t k = 0; k < size; k++)
+    {
+        double sum = 0;
+        for (size_t n = 0; n < size; n++)
+        {
+            double x = in[n];
+            // products are reduced modulo the period to keep the reference exact for large sizes
+            double arg;
+            switch (kind)
+            {
+            case dct_kind::II:
+                arg = pi * ((2 * n + 1) * (sine ? k + 1 : k) % (4 * size)) / (2 * size);
+                break;
+            case dct_kind::III:
+                arg = pi * ((2 * k + 1) * (sine ? n + 1 : n) % (4 * size)) / (2 * size);
+                if (n == (sine ? size - 1 : 0))
+                    x *= 0.5;
+                break;
+            default:
+                arg = pi * ((2 * n + 1) * (2 * k + 1) % (8 * size)) / (4 * size);
+                break;
+            }
+            sum += x * (sine ? std::sin(arg) : std::cos(arg));
+        }
+        out[k] = static_cast<T>(sum);
+    }
+}
+
+TEST(dct)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type") = ctypes<float, double>, //
+                  named("kind") = std::make_tuple(0, 1, 2), //
+                  named("size") = std::make_tuple(2, 4, 16, 60, 256, 1024, 1000), //
+                  [&gen](auto type, int kind_index, size_t size) {
+                      using float_type = type_of<decltype(type)>;
+                      const dct_kind kind =
+                          kind_index == 0 ? dct_kind::II : kind_index == 1 ? dct_kind::III : dct_kind::IV;
+
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), size);
+                      univector<float_type> out(size), refout(size);
+                      const dct_plan<float_type> dct(size);
+                      const dst_plan<float_type> dst(size);
+                      univector<u8> temp(dct.temp_size);
+
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+
+                      dct.execute(out, in, temp, kind);
+                      reference_dct(refout, in, kind, false);
+                      CHECK(rms(refout - out) < epsilon * ops);
+
+                      dst.execute(out, in, temp, kind);
+                      reference_dct(refout, in, kind, true);
+                      CHECK(rms(refout - out) < epsilon * ops);
+
+                      // in place
+                      out = in;
+                      dct.execute(out, out, temp, kind);
+                      reference_dct(refout, in, kind, false);
+                      CHECK(rms(refout - out) < epsilon * ops);
+                  });
+}
+
+TEST(mdct)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type") = ctypes<float, double>, //
+                  named("size") = std::make_tuple(4, 16, 256, 480), //
+                  [&gen](auto type, size_t size) {
+                      using float_type      = type_of<decltype(type)>;
+                      const size_t frames   = 8;
+                      univector<float_type> in =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * frames);
+                      univector<float_type> out(size * frames), coefficients(size);
+
+                      mdct_stream<float_type> mdct(size);
+                      for (size_t f = 0; f < frames; f++)
+                      {
+                          mdct.analyze(coefficients.data(), in.data() + f * size);
+                          mdct.synthesize(out.data() + f * size, coefficients.data());
+                      }
+
+                      // output is delayed by one frame
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(rms(in.slice(0, size * (frames - 1)) - out.slice(size)) < epsilon * ops);
+                  });
+}
+
+TEST(fft_cpu)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    // every instruction set the radix-4 stages are built for that this host can run
+    cforeach(internal::dft_cpus, [&gen](auto cpu) {
+        if (val_of(cpu) > get_cpu())
+            return;
+        testo::matrix(named("type")       = ctypes<float, double>, //
+                      named("inverse")    = std::make_tuple(false, true), //
+                      named("log2(size)") = std::make_tuple(9, 12, 15, 16), //
+                      [&gen, cpu](auto type, bool inverse, size_t log2size) {
+                          using float_type  = type_of<decltype(type)>;
+                          const size_t size = 1 << log2size;
+
+                          univector<complex<float_type>> in =
+                              typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                          univector<complex<float_type>> out(size), refout(size);
+                          dft_config config;
+                          config.cpu = val_of(cpu);
+                          const dft_plan<float_type> dft(size, config);
+                          univector<u8> temp(dft.temp_size);
+                          CHECK(dft.config.cpu == val_of(cpu));
+
+                          reference_dft(refout.data(), in.data(), size, inverse);
+                          dft.execute(out, in, temp, inverse);
+
+                          const double ops     = log2size * 100;
+                          const double epsilon = std::numeric_limits<float_type>::epsilon();
+                          CHECK(rms(cabs(refout - out)) < epsilon * ops);
+                      });
+    });
+}
+
+TEST(stft)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")    = ctypes<float, double>, //
+                  named("size")    = std::make_tuple(16, 256, 1024), //
+                  named("overlap") = std::make_tuple(2, 3, 4), //
+                  [&gen](auto type, size_t size, size_t overlap) {
+                      using float_type    = type_of<decltype(type)>;
+                      const size_t hop    = size / overlap;
+                      const size_t frames = 40;
+                      const size_t length = hop * frames;
+                      univector<float_type> in =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                      univector<float_type> out(length);
+
+                      stft<float_type> analysis(size, hop);
+                      istft<float_type> synthesis(size, hop);
+                      univector<complex<float_type>> last(analysis.bins());
+                      const size_t blocks[] = { 1, 7, 64, 333 };
+                      size_t position = 0, written = 0, frame = 0, block = 0;
+                      while (position < length)
+                      {
+                          const size_t count = std::min(blocks[block++ % 4], length - position);
+                          frame += analysis.process(in.data() + position, count,
+                                                    [&](const complex<float_type>* spectrum) {
+                                                        synthesis.process(out.data() + written, spectrum);
+                                                        written += hop;
+                                                        builtin_memcpy(last.data(), spectrum,
+                                                                       sizeof(complex<float_type>) * last.size());
+                                                    });
+                          position += count;
+                      }
+                      CHECK(frame == frames);
+                      CHECK(written == length);
+
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+
+                      // the last frame ends with the last input sample
+                      const univector<float_type> window = internal::stft_default_window<float_type>(size);
+                      univector<complex<float_type>> windowed(size), refout(size);
+                      for (size_t i = 0; i < size; i++)
+                          windowed[i] = complex<float_type>(in[length - size + i] * window[i], 0);
+                      reference_dft(refout.data(), windowed.data(), size);
+                      CHECK(rms(cabs(refout.slice(0, last.size()) - last)) < epsilon * ops * size);
+
+                      // output is delayed by size - hop samples
+                      CHECK(rms(in.slice(0, length - (size - hop)) - out.slice(size - hop)) < epsilon * ops);
+                  });
+}
+
+TEST(dft_pruned)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")    = ctypes<float, double>, //
+                  named("inverse") = std::make_tuple(false, true), //
+                  named("size")    = std::make_tuple(1, 16, 60, 1000, 4096), //
+                  [&gen](auto type, bool inverse, size_t size) {
+                      using float_type     = type_of<decltype(type)>;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      const double ops     = (ilog2(next_poweroftwo(size)) + 1) * 100;
+
+                      for (size_t part : { size_t(1), size / 8, size / 3, size })
+                      {
+                          if (part == 0)
+                              continue;
+                          univector<complex<float_type>> in =
+                              typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                          univector<complex<float_type>> refout(size);
+                          univector<complex<float_type>> out(size);
+
+                          // only the first part samples are nonzero
+                          in.slice(part) = scalar(complex<float_type>(0));
+                          reference_dft(refout.data(), in.data(), size, inverse);
+                          const dft_plan_pruned_input<float_type> input_plan(size, part);
+                          univector<u8> temp(input_plan.temp_size);
+                          input_plan.execute(out.data(), in.data(), temp.data(), inverse);
+                          CHECK(rms(cabs(refout - out)) < epsilon * ops);
+
+                          // only bins from size / 4 to size / 4 + bins - 1 are computed
+                          const size_t bins = std::min(part, size - size / 4);
+                          in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                          reference_dft(refout.data(), in.data(), size, inverse);
+                          const dft_plan_pruned_output<float_type> output_plan(size, size / 4, bins);
+                          univector<u8> output_temp(output_plan.temp_size);
+                          output_plan.execute(out.data(), in.data(), output_temp.data(), inverse);
+                          CHECK(rms(cabs(refout.slice(size / 4, bins) - out.slice(0, bins))) < epsilon * ops);
+                      }
+
+                      // sizes past the end of the transform are clamped
+                      CHECK(dft_plan_pruned_input<float_type>(size, size * 2).input_size == size);
+                      CHECK(dft_plan_pruned_output<float_type>(size, 0, size + 1).count == size);
+                  });
+}
+
+TEST(czt)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")  = ctypes<float, double>, //
+                  named("size")  = std::make_tuple(1, 7, 64, 1000), //
+                  named("count") = std::make_tuple(1, 10, 129, 500), //
+                  [&gen](auto type, size_t size, size_t count) {
+                      using float_type = type_of<decltype(type)>;
+                      univector<complex<float_type>> in =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), size * 2);
+                      univector<complex<float_type>> out(count);
+                      univector<complex<float_type>> refout(count);
+
+                      // 1 Hz bins from 900 Hz at 8 kHz
+                      const double first = 900.0 / 8000.0;
+                      const double step  = 1.0 / 8000.0;
+                      const czt_plan<float_type> czt = czt_plan<float_type>::zoom(size, count, first, step);
+                      univector<u8> temp(czt.temp_size);
+                      czt.execute(out, in, temp);
+
+                      for (size_t k = 0; k < count; k++)
+                      {
+                          double re = 0, im = 0;
+                          for (size_t n = 0; n < size; n++)
+                          {
+                              const double phase = -c_pi<double, 2> * n * (first + k * step);
+                              re += in[n].real() * std::cos(phase) - in[n].imag() * std::sin(phase);
+                              im += in[n].real() * std::sin(phase) + in[n].imag() * std::cos(phase);
+                          }
+                          refout[k] =
+                              complex<float_type>(static_cast<float_type>(re), static_cast<float_type>(im));
+                      }
+
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      const double ops     = (ilog2(next_poweroftwo(size + count)) + 1) * 100;
+                      CHECK(rms(cabs(refout - out)) < epsilon * ops * std::sqrt(double(size)));
+                  });
+}
+
 int main(int argc, char** argv)
 {
     println(library_version());
@@ -0,0 +1,202 @@
+/**
+ * KFR (http://kfrlib.com)
+ * Copyright (C) 2016  D Levin
+ * See LICENSE.txt for details
+ */
+
+// library_version()
+#include <kfr/io/tostring.hpp>
+#include <kfr/version.hpp>
+
+#include <kfr/expressions/basic.hpp>
+#include <kfr/expressions/pointer.hpp>
+#include <kfr/expressions/reduce.hpp>
+#include <kfr/misc/random.hpp>
+
+#include <tuple>
+
+#include "testo/testo.hpp"
+#include <kfr/dsp/fir.hpp>
+
+using namespace kfr;
+
+TEST(test_fir_filter)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")     = ctypes<float, double>, //
+                  named("tapcount") = std::make_tuple(1, 2, 7, 32, 127, 1000), //
+                  [&gen](auto type, size_t tapcount) {
+                      using float_type    = type_of<decltype(type)>;
+                      const size_t length = 5000;
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                      univector<float_type> taps =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), tapcount) / float_type(tapcount);
+                      univector<float_type> ref(length);
+                      ref = native::fir(in, taps);
+
+                      fir_filter<float_type> filter(taps);
+                      univector<float_type> out(length);
+                      const size_t blocks[] = { 1, 13, 64, 2000 };
+                      for (size_t position = 0, block = 0; position < length;)
+                      {
+                          const size_t count = std::min(blocks[block++ % 4], length - position);
+                          filter.process(out.data() + position, in.data() + position, count);
+                          position += count;
+                      }
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      CHECK(native::rms(ref - out) < epsilon * 10);
+
+                      // in-place processing after a reset restarts from silence
+                      filter.reset();
+                      out = in;
+                      filter.process(out, out);
+                      CHECK(native::rms(ref - out) < epsilon * 10);
+                  });
+}
+
+TEST(test_fir_symmetric)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")     = ctypes<float, double>, //
+                  named("tapcount") = std::make_tuple(2, 3, 30, 31, 128, 511), //
+                  [&gen](auto type, size_t tapcount) {
+                      using float_type    = type_of<decltype(type)>;
+                      const size_t length = 3000;
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                      const double epsilon     = std::numeric_limits<float_type>::epsilon();
+
+                      univector<float_type> lowpass(tapcount);
+                      const expression_pointer<float_type> kaiser =
+                          to_pointer(native::window_kaiser(tapcount, float_type(3.0)));
+                      native::fir_lowpass(lowpass, float_type(0.2), kaiser, true);
+
+                      univector<float_type> differentiator =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), tapcount);
+                      for (size_t k = 0; k < tapcount / 2; k++)
+                          differentiator[tapcount - 1 - k] = -differentiator[k];
+                      if (tapcount % 2 == 1)
+                          differentiator[tapcount / 2] = 0;
+
+                      univector<float_type> ref(length), out(length);
+                      fir_filter<float_type> symmetric(lowpass);
+                      CHECK(symmetric.symmetry() == fir_symmetry::symmetric);
+                      ref = native::fir(in, lowpass);
+                      symmetric.process(out, in);
+                      CHECK(native::rms(ref - out) < epsilon * 10);
+
+                      fir_filter<float_type> antisymmetric(differentiator);
+                      CHECK(antisymmetric.symmetry() == fir_symmetry::antisymmetric);
+                      ref = native::fir(in, differentiator);
+                      antisymmetric.process(out, in);
+                      CHECK(native::rms(ref - out) < epsilon * 10);
+                  });
+
+    univector<double> taps({ 1, 2, 3 });
+    CHECK(fir_filter<double>(taps).symmetry() == fir_symmetry::none);
+}
+
+TEST(test_fir_bank)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")     = ctypes<float, double>, //
+                  named("channels") = std::make_tuple(1, 3, 8, 37), //
+                  named("tapcount") = std::make_tuple(1, 7, 64), //
+                  [&gen](auto type, size_t channels, size_t tapcount) {
+                      using float_type    = type_of<decltype(type)>;
+                      const size_t length = 1000;
+                      univector<float_type> taps =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), tapcount) / float_type(tapcount);
+                      univector2d<float_type> in(channels), ref(channels), out(channels);
+                      univector<float_type> interleaved(length * channels);
+                      for (size_t c = 0; c < channels; c++)
+                      {
+                          in[c].resize(length);
+                          ref[c].resize(length);
+                          out[c].resize(length);
+                          in[c]  = typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                          ref[c] = native::fir(in[c], taps);
+                          for (size_t n = 0; n < length; n++)
+                              interleaved[n * channels + c] = in[c][n];
+                      }
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+
+                      fir_bank<float_type> bank(channels, taps);
+                      bank.process(out, in);
+                      for (size_t c = 0; c < channels; c++)
+                          CHECK(native::rms(ref[c] - out[c]) < epsilon * 10);
+
+                      // interleaved in place, in two calls
+                      bank.reset();
+                      bank.process_interleaved(interleaved.data(), interleaved.data(), 333);
+                      bank.process_interleaved(interleaved.data() + 333 * channels,
+                                               interleaved.data() + 333 * channels, length - 333);
+                      double error = 0;
+                      for (size_t c = 0; c < channels; c++)
+                          for (size_t n = 0; n < length; n++)
+                              error = std::max(error, std::abs(double(interleaved[n * channels + c]) -
+                                                               double(ref[c][n])));
+                      CHECK(error < epsilon * 10);
+                  });
+}
+
+TEST(test_fir_polyphase)
+{
+    random_bit_generator gen(2247448713, 915890490, 864203735, 2982561);
+
+    testo::matrix(named("type")     = ctypes<float, double>, //
+                  named("factor")   = std::make_tuple(1, 2, 3, 8), //
+                  named("tapcount") = std::make_tuple(1, 5, 64, 255), //
+                  [&gen](auto type, size_t factor, size_t tapcount) {
+                      using float_type     = type_of<decltype(type)>;
+                      const size_t length  = 2400;
+                      const double epsilon = std::numeric_limits<float_type>::epsilon();
+                      univector<float_type> in = typed<float_type>(gen_random_range(gen, -1.0, +1.0), length);
+                      univector<float_type> taps =
+                          typed<float_type>(gen_random_range(gen, -1.0, +1.0), tapcount) / float_type(tapcount);
+                      const size_t blocks[] = { 1, 13, 64, 700 };
+
+                      // decimation keeps every factor-th output of the full rate filter
+                      univector<float_type> full(length);
+                      full = native::fir(in, taps);
+                      univector<float_type> decimated(length / factor + 1);
+                      fir_decimator<float_type> decimator(factor, taps);
+                      size_t outputs = 0;
+                      for (size_t position = 0, block = 0; position < length;)
+                      {
+                          const size_t count = std::min(blocks[block++ % 4], length - position);
+                          outputs += decimator.process(decimated.data() + outputs, in.data() + position, count);
+                          position += count;
+                      }
+                      CHECK(outputs == (length + factor - 1) / factor);
+                      double error = 0;
+                      for (size_t m = 0; m < outputs; m++)
+                          error = std::max(error, std::abs(double(decimated[m]) - double(full[m * factor])));
+                      CHECK(error < epsilon * 10);
+
+                      // interpolation is the same as filtering the zero-stuffed input
+                      univector<float_type> stuffed(length * factor, float_type(0));
+                      for (size_t n = 0; n < length; n++)
+                          stuffed[n * factor] = in[n];
+                      univector<float_type> ref(length * factor), interpolated(length * factor);
+                      ref = native::fir(stuffed, taps);
+                      fir_interpolator<float_type> interpolator(factor, taps);
+                      for (size_t position = 0, block = 0; position < length;)
+                      {
+                          const size_t count = std::min(blocks[block++ % 4], length - position);
+                          interpolator.process(interpolated.data() + position * factor, in.data() + position,
+                                               count);
+                          position += count;
+                      }
+                      CHECK(native::rms(ref - interpolated) < epsilon * 10);
+                  });
+}
+
+int main(int argc, char** argv)
+{
+    println(library_version());
+
+    return testo::run_all("", true);
+}